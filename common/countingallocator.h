@@ -0,0 +1,95 @@
+#ifndef __COUNTINGALLOCATOR__
+#define __COUNTINGALLOCATOR__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace swss {
+
+/* Memory currently held through the allocators sharing these counters */
+struct AllocStats
+{
+    AllocStats() : bytes(0), blocks(0), peakBytes(0) { }
+
+    uint64_t            bytes;          // live bytes
+    uint64_t            blocks;         // live allocations, one per node for node based containers
+    uint64_t            peakBytes;      // highest bytes since start
+};
+
+/*
+ * std::allocator that accounts for what it hands out in an AllocStats. Only
+ * the container's own blocks are counted: memory owned by the elements
+ * (string buffers, nested containers) goes through their own allocators.
+ *
+ * The counters travel with the container on copy, move and swap, so that a
+ * block is always released against the counters it was taken from. An
+ * allocator built without counters does not count.
+ */
+template <class T>
+class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    CountingAllocator() : m_stats(NULL) { }
+    explicit CountingAllocator(AllocStats *stats) : m_stats(stats) { }
+    template <class U>
+    CountingAllocator(const CountingAllocator<U> &other) : m_stats(other.getStats()) { }
+
+    T *allocate(size_t n)
+    {
+        T *p = std::allocator<T>().allocate(n);
+        if (m_stats)
+        {
+            m_stats->bytes += n * sizeof(T);
+            m_stats->blocks++;
+            if (m_stats->bytes > m_stats->peakBytes)
+                m_stats->peakBytes = m_stats->bytes;
+        }
+        return p;
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (m_stats)
+        {
+            m_stats->bytes -= n * sizeof(T);
+            m_stats->blocks--;
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    AllocStats *getStats() const { return m_stats; }
+
+private:
+    AllocStats *m_stats;
+};
+
+template <class T, class U>
+bool operator==(const CountingAllocator<T> &a, const CountingAllocator<U> &b)
+{
+    return a.getStats() == b.getStats();
+}
+
+template <class T, class U>
+bool operator!=(const CountingAllocator<T> &a, const CountingAllocator<U> &b)
+{
+    return a.getStats() != b.getStats();
+}
+
+/* std::map whose nodes are accounted for, built with CountingMap<K, V>::allocator_type(&stats) */
+template <class K, class V, class C = std::less<K>>
+using CountingMap = std::map<K, V, C, CountingAllocator<std::pair<const K, V>>>;
+
+}
+
+#endif
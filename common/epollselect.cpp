@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <algorithm>
+#include <system_error>
+
+#include "common/epollselect.h"
+
+using namespace std;
+
+namespace swss {
+
+static vector<int> getSelectableFds(Selectable *selectable)
+{
+    vector<int> fds;
+
+    FdSelectable *fdSelectable = dynamic_cast<FdSelectable *>(selectable);
+    if (fdSelectable)
+    {
+        fds.push_back(fdSelectable->getFd());
+        return fds;
+    }
+
+    fd_set fs;
+    FD_ZERO(&fs);
+    selectable->addFd(&fs);
+    for (int fd = 0; fd < FD_SETSIZE; fd++)
+    {
+        if (FD_ISSET(fd, &fs))
+            fds.push_back(fd);
+    }
+
+    return fds;
+}
+
+EpollSelect::EpollSelect()
+{
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epfd < 0)
+        throw system_error(errno, system_category());
+}
+
+EpollSelect::~EpollSelect()
+{
+    close(m_epfd);
+}
+
+void EpollSelect::addSelectable(Selectable *selectable)
+{
+    if (m_fds.find(selectable) != m_fds.end())
+        return;
+
+    vector<int> fds = getSelectableFds(selectable);
+    for (int fd : fds)
+    {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = selectable;
+
+        if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            throw system_error(errno, system_category());
+    }
+
+    m_fds[selectable] = fds;
+
+    /* Data may already be cached before the first wakeup */
+    m_lastReady.push_back(selectable);
+}
+
+void EpollSelect::addSelectables(vector<Selectable *> selectables)
+{
+    for (Selectable *selectable : selectables)
+        addSelectable(selectable);
+}
+
+void EpollSelect::removeSelectable(Selectable *selectable)
+{
+    auto it = m_fds.find(selectable);
+    if (it == m_fds.end())
+        return;
+
+    for (int fd : it->second)
+        epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, NULL);
+
+    m_fds.erase(it);
+    m_lastReady.erase(remove(m_lastReady.begin(), m_lastReady.end(), selectable),
+                      m_lastReady.end());
+}
+
+int EpollSelect::select(vector<Selectable *> &ready, int timeout)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n;
+
+    ready.clear();
+
+    /* Only the selectables returned last time can hold unconsumed data */
+    for (Selectable *selectable : m_lastReady)
+    {
+        int ret = selectable->readCache();
+        if (ret == Selectable::ERROR)
+            return EpollSelect::ERROR;
+        if (ret == Selectable::DATA)
+            ready.push_back(selectable);
+    }
+
+    do
+    {
+        n = epoll_wait(m_epfd, events, MAX_EVENTS, ready.empty() ? timeout : 0);
+    }
+    while (n < 0 && errno == EINTR);
+
+    if (n < 0)
+        return EpollSelect::ERROR;
+
+    for (int i = 0; i < n; i++)
+    {
+        Selectable *selectable = (Selectable *)events[i].data.ptr;
+
+        /* It may have been removed by a previous readMe() of this batch */
+        if (m_fds.find(selectable) == m_fds.end())
+            continue;
+
+        /*
+         * A selectable with cached data is returned for it alone, so that
+         * the caller consumes one entry per notification taken. Its
+         * descriptor stays readable until the cache is drained.
+         */
+        if (find(ready.begin(), ready.end(), selectable) != ready.end())
+            continue;
+
+        selectable->readMe();
+        ready.push_back(selectable);
+    }
+
+    /* A later readMe() of this batch may have removed and freed an earlier one */
+    ready.erase(remove_if(ready.begin(), ready.end(),
+                          [this](Selectable *selectable) { return m_fds.find(selectable) == m_fds.end(); }),
+                ready.end());
+    m_lastReady = ready;
+
+    return ready.empty() ? EpollSelect::TIMEOUT : EpollSelect::OBJECT;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef __EPOLLSELECT__
+#define __EPOLLSELECT__
+
+#include <map>
+#include <vector>
+#include "selectable.h"
+
+namespace swss {
+
+/*
+ * Selectables that own a single file descriptor implement this interface so
+ * that EpollSelect can register them directly. Other selectables are probed
+ * once through addFd(), which only reports descriptors below FD_SETSIZE.
+ */
+class FdSelectable
+{
+public:
+    virtual ~FdSelectable() {}
+    virtual int getFd() = 0;
+};
+
+/*
+ * epoll based replacement of Select. Registration is done once, every wakeup
+ * costs O(ready) and select() returns all the selectables that are ready.
+ */
+class EpollSelect
+{
+public:
+    enum { MAX_EVENTS = 64 };
+    enum { OBJECT = 0, ERROR = 2, TIMEOUT = 3 };
+
+    EpollSelect();
+    ~EpollSelect();
+
+    void addSelectable(Selectable *selectable);
+    void addSelectables(std::vector<Selectable *> selectables);
+    void removeSelectable(Selectable *selectable);
+
+    /*
+     * Wait up to timeout milliseconds (-1 blocks) and fill ready with every
+     * selectable that has data: the ones whose descriptor fired, on which
+     * readMe() has been called, and the ones returned by the previous call
+     * that still have cached data. readMe() is not called on the latter
+     * before their cache is drained.
+     */
+    int select(std::vector<Selectable *> &ready, int timeout = -1);
+
+private:
+    int m_epfd;
+    std::map<Selectable *, std::vector<int> > m_fds;
+    std::vector<Selectable *> m_lastReady;
+};
+
+}
+
+#endif
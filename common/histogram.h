@@ -0,0 +1,136 @@
+#ifndef __HISTOGRAM__
+#define __HISTOGRAM__
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace swss {
+
+/*
+ * Log2 histogram of latencies in nanoseconds. Bucket i counts the samples in
+ * [2^i, 2^(i+1)), so percentiles are reported as the upper bound of the
+ * bucket they fall in, capped to the largest sample seen.
+ */
+class LatencyHistogram
+{
+public:
+    enum { BUCKETS = 64 };
+
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void add(uint64_t ns)
+    {
+        m_buckets[ns ? 63 - __builtin_clzll(ns) : 0]++;
+        m_count++;
+        m_sum += ns;
+        if (ns > m_max)
+            m_max = ns;
+    }
+
+    /* Add the samples of other, e.g. to sum up the windows of a rolling histogram */
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < BUCKETS; i++)
+            m_buckets[i] += other.m_buckets[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        if (other.m_max > m_max)
+            m_max = other.m_max;
+    }
+
+    void reset()
+    {
+        memset(m_buckets, 0, sizeof(m_buckets));
+        m_count = 0;
+        m_sum = 0;
+        m_max = 0;
+    }
+
+    uint64_t getCount() const { return m_count; }
+    uint64_t getMax() const { return m_max; }
+    uint64_t getMean() const { return m_count ? m_sum / m_count : 0; }
+
+    /* p-th percentile, p in [0, 100] */
+    uint64_t getPercentile(double p) const
+    {
+        if (!m_count)
+            return 0;
+
+        /* Nearest rank */
+        uint64_t rank = (uint64_t)ceil(p * m_count / 100);
+        if (rank == 0)
+            rank = 1;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += m_buckets[i];
+            if (seen >= rank)
+            {
+                uint64_t upper = i == BUCKETS - 1 ? UINT64_MAX : (2ULL << i) - 1;
+                return upper < m_max ? upper : m_max;
+            }
+        }
+        return m_max;
+    }
+
+private:
+    uint64_t m_buckets[BUCKETS];
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_max;
+};
+
+/*
+ * LatencyHistogram of the samples added over the last SLOTS windows of
+ * slotSec seconds. Times are seconds of whatever clock the caller uses.
+ */
+template <int SLOTS>
+class WindowedHistogram
+{
+public:
+    WindowedHistogram(uint64_t slotSec) : m_slotSec(slotSec)
+    {
+        memset(m_epochs, 0, sizeof(m_epochs));
+    }
+
+    void add(uint64_t sec, uint64_t ns)
+    {
+        uint64_t epoch = sec / m_slotSec;
+        int slot = epoch % SLOTS;
+        if (m_epochs[slot] != epoch)
+        {
+            m_slots[slot].reset();
+            m_epochs[slot] = epoch;
+        }
+        m_slots[slot].add(ns);
+    }
+
+    LatencyHistogram get(uint64_t sec) const
+    {
+        LatencyHistogram histogram;
+        uint64_t epoch = sec / m_slotSec;
+
+        for (int i = 0; i < SLOTS; i++)
+        {
+            if (m_epochs[i] + SLOTS > epoch)
+                histogram.merge(m_slots[i]);
+        }
+        return histogram;
+    }
+
+    uint64_t getWindowSec() const { return SLOTS * m_slotSec; }
+
+private:
+    uint64_t m_slotSec;
+    LatencyHistogram m_slots[SLOTS];
+    uint64_t m_epochs[SLOTS];
+};
+
+}
+
+#endif
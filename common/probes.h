@@ -0,0 +1,35 @@
+#ifndef __PROBES__
+#define __PROBES__
+
+/*
+ * SystemTap SDT (USDT) static probes of the "swss" provider, e.g.
+ *   bpftrace -e 'usdt:/usr/bin/orchagent:swss:task_pop { @[str(arg0)] = count(); }'
+ *   perf probe -x /usr/bin/orchagent sdt_swss:task_pop
+ *
+ * A probe compiles to a nop and a note in the ELF file, but its arguments
+ * are always evaluated, tracer attached or not: only pass values already at
+ * hand, such as the c_str() of a stored string, never the result of a call
+ * building one. Without <sys/sdt.h> at configure time the macros expand to
+ * nothing and the arguments are not evaluated at all.
+ */
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define SWSS_PROBE(name)                                DTRACE_PROBE(swss, name)
+#define SWSS_PROBE1(name, a1)                           DTRACE_PROBE1(swss, name, a1)
+#define SWSS_PROBE2(name, a1, a2)                       DTRACE_PROBE2(swss, name, a1, a2)
+#define SWSS_PROBE3(name, a1, a2, a3)                   DTRACE_PROBE3(swss, name, a1, a2, a3)
+#define SWSS_PROBE4(name, a1, a2, a3, a4)               DTRACE_PROBE4(swss, name, a1, a2, a3, a4)
+
+#else
+
+#define SWSS_PROBE(name)                                do { } while (0)
+#define SWSS_PROBE1(name, a1)                           do { } while (0)
+#define SWSS_PROBE2(name, a1, a2)                       do { } while (0)
+#define SWSS_PROBE3(name, a1, a2, a3)                   do { } while (0)
+#define SWSS_PROBE4(name, a1, a2, a3, a4)               do { } while (0)
+
+#endif
+
+#endif
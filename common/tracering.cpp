@@ -0,0 +1,76 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "common/tracering.h"
+
+using namespace std;
+
+namespace swss {
+
+TraceRingHeader *TraceRing::m_header = NULL;
+TraceRecord *TraceRing::m_records = NULL;
+uint64_t TraceRing::m_mask = 0;
+
+bool TraceRing::open(const string &path, uint32_t capacity)
+{
+    uint32_t size = 1;
+    while (size < capacity && size < (1U << 31))
+        size <<= 1;
+
+    /* Keep the events that led to the previous exit */
+    rename(path.c_str(), (path + ".prev").c_str());
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    size_t length = sizeof(TraceRingHeader) + (size_t)size * sizeof(TraceRecord);
+    if (ftruncate(fd, length) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    m_header = (TraceRingHeader *)addr;
+    memcpy(m_header->magic, TRACE_RING_MAGIC, TRACE_RING_MAGIC_SIZE);
+    m_header->recordSize = sizeof(TraceRecord);
+    m_header->capacity = size;
+    m_header->head = 0;
+
+    m_mask = size - 1;
+    m_records = (TraceRecord *)(m_header + 1);
+    return true;
+}
+
+void TraceRing::write(uint32_t event, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t index = __atomic_fetch_add(&m_header->head, 1, __ATOMIC_RELAXED);
+    TraceRecord &r = m_records[index & m_mask];
+
+    __atomic_store_n(&r.seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    r.time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    r.event = event;
+    r.args[0] = a0;
+    r.args[1] = a1;
+    r.args[2] = a2;
+    r.args[3] = a3;
+
+    __atomic_store_n(&r.seq, index + 1, __ATOMIC_RELEASE);
+}
+
+}
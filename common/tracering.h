@@ -0,0 +1,68 @@
+#ifndef __TRACERING__
+#define __TRACERING__
+
+#include <stdint.h>
+#include <string>
+
+namespace swss {
+
+/*
+ * Fixed-size binary trace records in a ring mapped from a file, so that the
+ * latest events of a process can be decoded while it runs or after it died.
+ * Writers claim a slot with an atomic increment of head and publish it by
+ * storing its sequence number last; a reader keeps the records whose
+ * sequence number matches their position and skips the ones being written.
+ *
+ * Event ids and the meaning of their arguments are defined by the program
+ * that records them, see orchagent/traceevents.h.
+ */
+#define TRACE_RING_MAGIC        "SWSSTRC1"
+#define TRACE_RING_MAGIC_SIZE   8
+#define TRACE_RING_MAX_ARGS     4
+
+struct TraceRecord
+{
+    uint64_t            seq;            // position in the ring + 1, 0 while being written
+    uint64_t            time;           // unix time (ns)
+    uint32_t            event;
+    uint32_t            reserved;
+    uint64_t            args[TRACE_RING_MAX_ARGS];
+};
+
+struct TraceRingHeader
+{
+    char                magic[TRACE_RING_MAGIC_SIZE];
+    uint32_t            recordSize;     // sizeof(TraceRecord)
+    uint32_t            capacity;       // records, a power of two
+    uint64_t            head;           // records written since the ring was created
+    uint64_t            reserved[5];    // pads the header to 64 bytes
+};
+
+class TraceRing
+{
+public:
+    /*
+     * Create the ring file at path with room for capacity records, rounded
+     * up to a power of two. The ring of a previous run is kept as path.prev.
+     */
+    static bool open(const std::string &path, uint32_t capacity);
+    static bool isEnabled() { return m_records != NULL; }
+
+    static void record(uint32_t event, uint64_t a0 = 0, uint64_t a1 = 0,
+                       uint64_t a2 = 0, uint64_t a3 = 0)
+    {
+        if (m_records)
+            write(event, a0, a1, a2, a3);
+    }
+
+private:
+    static TraceRingHeader *m_header;
+    static TraceRecord *m_records;
+    static uint64_t m_mask;
+
+    static void write(uint32_t event, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3);
+};
+
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include "netmsg.h"
 #include "netdispatcher.h"
 #include "fpmsyncd/fpmlink.h"
+#include "common/probes.h"
 
 using namespace swss;
 using namespace std;
@@ -90,6 +91,11 @@ bool FpmLink::isMe(fd_set *fd)
     return FD_ISSET(m_connection_socket, fd);
 }
 
+int FpmLink::getFd()
+{
+    return m_connection_socket;
+}
+
 int FpmLink::readCache()
 {
     /* FPM doesn't have any caching */
@@ -109,6 +115,7 @@ void FpmLink::readMe()
     if (read < 0)
         throw std::system_error(errno, std::system_category());
     m_pos+= read;
+    SWSS_PROBE2(fpm_read, read, m_pos);
 
     /* Check for complete messages */
     while (true)
@@ -127,6 +134,7 @@ void FpmLink::readMe()
 
         if (hdr->msg_type == FPM_MSG_TYPE_NETLINK)
         {
+            SWSS_PROBE1(fpm_msg_entry, msg_len);
             nl_msg *msg = nlmsg_convert((nlmsghdr *)fpm_msg_data(hdr));
             if (msg == NULL)
                 throw std::system_error(make_error_code(errc::bad_message), "Unable to convert nlmsg");
@@ -134,6 +142,7 @@ void FpmLink::readMe()
             nlmsg_set_proto(msg, NETLINK_ROUTE);
             NetDispatcher::getInstance().onNetlinkMessage(msg);
             nlmsg_free(msg);
+            SWSS_PROBE1(fpm_msg_return, msg_len);
         }
         start += msg_len;
     }
@@ -12,11 +12,12 @@
 #include <exception>
 
 #include "selectable.h"
+#include "common/epollselect.h"
 #include "fpm/fpm.h"
 
 namespace swss {
 
-class FpmLink : public Selectable {
+class FpmLink : public Selectable, public FdSelectable {
 public:
     FpmLink(int port = FPM_DEFAULT_PORT);
     virtual ~FpmLink();
@@ -26,6 +27,7 @@ public:
 
     virtual void addFd(fd_set *fd);
     virtual bool isMe(fd_set *fd);
+    virtual int getFd();
     virtual int readCache();
     virtual void readMe();
 
@@ -1,6 +1,7 @@
 #include <iostream>
+#include <getopt.h>
 #include "logger.h"
-#include "select.h"
+#include "common/epollselect.h"
 #include "netdispatcher.h"
 #include "fpmsyncd/fpmlink.h"
 #include "fpmsyncd/routesync.h"
@@ -8,10 +9,36 @@
 using namespace std;
 using namespace swss;
 
+void usage(char **argv)
+{
+    cout << "Usage: " << argv[0] << " [-t]" << endl;
+    cout << "  -t  stamp routes with their FPM receive time (\"timestamp\" field)" << endl;
+}
+
 int main(int argc, char **argv)
 {
+    bool timestamp = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "th")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            timestamp = true;
+            break;
+        case 'h':
+            usage(argv);
+            return 0;
+        default: /* '?' */
+            usage(argv);
+            return 1;
+        }
+    }
+
     DBConnector db(APPL_DB, "localhost", 6379, 0);
     RouteSync sync(&db);
+    sync.setTimestamp(timestamp);
 
     NetDispatcher::getInstance().registerMessageHandler(RTM_NEWROUTE, &sync);
     NetDispatcher::getInstance().registerMessageHandler(RTM_DELROUTE, &sync);
@@ -21,7 +48,7 @@ int main(int argc, char **argv)
         try
         {
             FpmLink fpm;
-            Select s;
+            EpollSelect s;
 
             cout << "Waiting for connection..." << endl;
             fpm.accept();
@@ -30,10 +57,9 @@ int main(int argc, char **argv)
             s.addSelectable(&fpm);
             while (true)
             {
-                Selectable *temps;
-                int tempfd;
+                vector<Selectable *> ready;
                 /* Reading FPM messages forever (and calling "readMe" to read them) */
-                s.select(&temps, &tempfd);
+                s.select(ready);
             }
         }
         catch (FpmLink::FpmConnectionClosedException &e)
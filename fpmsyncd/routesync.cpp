@@ -9,12 +9,16 @@
 #include "producertable.h"
 #include "fpmsyncd/fpmlink.h"
 #include "fpmsyncd/routesync.h"
+#include "common/probes.h"
+
+#include <chrono>
 
 using namespace std;
 using namespace swss;
 
 RouteSync::RouteSync(DBConnector *db) :
-    m_routeTable(db, APP_ROUTE_TABLE_NAME)
+    m_routeTable(db, APP_ROUTE_TABLE_NAME),
+    m_timestamp(false)
 {
     m_nl_sock = nl_socket_alloc();
     nl_connect(m_nl_sock, NETLINK_ROUTE);
@@ -29,6 +33,12 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
     uint32_t ipv4;
     int prefix;
 
+    /* Taken first, so that it covers the parsing below */
+    string timestamp;
+    if (m_timestamp)
+        timestamp = to_string(chrono::duration_cast<chrono::microseconds>(
+                chrono::system_clock::now().time_since_epoch()).count());
+
     dip = rtnl_route_get_dst(route_obj);
     /* Supports IPv4 address only for now */
     if (rtnl_route_get_family(route_obj)  != AF_INET)
@@ -45,7 +55,9 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
 
     if (nlmsg_type == RTM_DELROUTE)
     {
+        SWSS_PROBE2(route_del_entry, ipv4, prefix);
         m_routeTable.del(destip.to_string());
+        SWSS_PROBE2(route_del_return, ipv4, prefix);
         return;
     }
     else if (nlmsg_type != RTM_NEWROUTE)
@@ -63,7 +75,11 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
                 std::vector<FieldValueTuple> fvVector;
                 FieldValueTuple fv("blackhole", "true");
                 fvVector.push_back(fv);
+                if (m_timestamp)
+                    fvVector.push_back(FieldValueTuple("timestamp", timestamp));
+                SWSS_PROBE3(route_set_entry, ipv4, prefix, 0);
                 m_routeTable.set(destip.to_string(), fvVector);
+                SWSS_PROBE2(route_set_return, ipv4, prefix);
                 return;
             }
         case RTN_UNICAST:
@@ -94,7 +110,8 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
         return;
     }
 
-    for (int i = 0; i < rtnl_route_get_nnexthops(route_obj); i++)
+    int nnexthops = rtnl_route_get_nnexthops(route_obj);
+    for (int i = 0; i < nnexthops; i++)
     {
         struct rtnl_nexthop *nexthop = rtnl_route_nexthop_n(route_obj, i);
         struct nl_addr *addr = rtnl_route_nh_get_gateway(nexthop);
@@ -117,7 +134,7 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
         }
 
 
-        if (i + 1 < rtnl_route_get_nnexthops(route_obj))
+        if (i + 1 < nnexthops)
         {
             nexthops += string(",");
             ifindexes += string(",");
@@ -129,5 +146,9 @@ void RouteSync::onMsg(int nlmsg_type, struct nl_object *obj)
     FieldValueTuple idx("ifindex", ifindexes);
     fvVector.push_back(nh);
     fvVector.push_back(idx);
+    if (m_timestamp)
+        fvVector.push_back(FieldValueTuple("timestamp", timestamp));
+    SWSS_PROBE3(route_set_entry, ipv4, prefix, nnexthops);
     m_routeTable.set(destip.to_string(), fvVector);
+    SWSS_PROBE2(route_set_return, ipv4, prefix);
 }
@@ -16,8 +16,12 @@ public:
 
     virtual void onMsg(int nlmsg_type, struct nl_object *obj);
 
+    /* Add the receive time (us since the epoch) to the routes set */
+    void setTimestamp(bool enable) { m_timestamp = enable; }
+
 private:
     ProducerTable m_routeTable;
+    bool m_timestamp;
     struct nl_cache *m_link_cache;
     struct nl_sock *m_nl_sock;
 };
@@ -1,6 +1,6 @@
 #include <iostream>
 #include "logger.h"
-#include "select.h"
+#include "common/epollselect.h"
 #include "netdispatcher.h"
 #include "netlink.h"
 #include "neighsyncd/neighsync.h"
@@ -21,7 +21,7 @@ int main(int argc, char **argv)
         try
         {
             NetLink netlink;
-            Select s;
+            EpollSelect s;
 
             netlink.registerGroup(RTNLGRP_NEIGH);
             cout << "Listens to neigh messages..." << endl;
@@ -30,9 +30,8 @@ int main(int argc, char **argv)
             s.addSelectable(&netlink);
             while (true)
             {
-                Selectable *temps;
-                int tempfd;
-                s.select(&temps, &tempfd);
+                vector<Selectable *> ready;
+                s.select(ready);
             }
         }
         catch (...)
@@ -16,10 +16,29 @@ extern sai_router_interface_api_t*  sai_router_intfs_api;
 extern sai_route_api_t*             sai_route_api;
 
 IntfsOrch::IntfsOrch(DBConnector *db, string tableName, PortsOrch *portsOrch) :
-        Orch(db, tableName), m_portsOrch(portsOrch)
+        Orch(db, tableName), m_portsOrch(portsOrch),
+        m_intfs(IntfsTable::allocator_type(&m_intfsMemory))
 {
 }
 
+void IntfsOrch::update(SubjectType type, void *cntx)
+{
+    if (type == SUBJECT_TYPE_PORT_CONFIG_DONE)
+        retryAllTasks(m_consumerMap.at(APP_INTF_TABLE_NAME));
+}
+
+void IntfsOrch::dumpState(vector<FieldValueTuple> &fvs)
+{
+    fvs.push_back(FieldValueTuple("orch", "IntfsOrch"));
+    fvs.push_back(FieldValueTuple("interfaces", to_string(m_intfs.size())));
+}
+
+void IntfsOrch::getMemoryStats(vector<pair<string, const AllocStats *>> &stats)
+{
+    Orch::getMemoryStats(stats);
+    stats.push_back(make_pair("IntfsTable", &m_intfsMemory));
+}
+
 void IntfsOrch::doTask(Consumer &consumer)
 {
     SWSS_LOG_ENTER();
@@ -37,7 +56,7 @@ void IntfsOrch::doTask(Consumer &consumer)
         if (found == string::npos)
         {
             SWSS_LOG_ERROR("Failed to parse task key %s\n", key.c_str());
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
         string alias = key.substr(0, found);
@@ -45,14 +64,14 @@ void IntfsOrch::doTask(Consumer &consumer)
         /* TODO: Sync loopback address and trap all IP packets to loopback addressy */
         if (alias == "lo" || alias == "eth0" || alias == "docker0")
         {
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
 
         IpPrefix ip_prefix(key.substr(found+1));
         if (!ip_prefix.isV4())
         {
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
 
@@ -63,7 +82,7 @@ void IntfsOrch::doTask(Consumer &consumer)
             /* Duplicate entry */
             if (m_intfs.find(alias) != m_intfs.end() && m_intfs[alias].contains(ip_prefix.getIp()))
             {
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
                 continue;
             }
 
@@ -71,7 +90,7 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (!m_portsOrch->getPort(alias, port))
             {
                 SWSS_LOG_ERROR("Failed to locate interface %s\n", alias.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
                 continue;
             }
 
@@ -102,6 +121,7 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (status != SAI_STATUS_SUCCESS)
             {
                 SWSS_LOG_ERROR("Failed to create subnet route pre:%s %d\n", ip_prefix.to_string().c_str(), status);
+                it->second.m_reason = "add subnet route failed";
                 it++;
                 continue;
             }
@@ -121,13 +141,14 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (status != SAI_STATUS_SUCCESS)
             {
                 SWSS_LOG_ERROR("Failed to create packet action trap route ip:%s %d\n", ip_prefix.getIp().to_string().c_str(), status);
+                it->second.m_reason = "add trap route failed";
                 it++;
             }
             else
             {
                 SWSS_LOG_NOTICE("Create packet action trap route ip:%s\n", ip_prefix.getIp().to_string().c_str());
                 m_intfs[alias].add(ip_prefix.getIp());
-                it = consumer.m_toSync.erase(it);
+                it = completeTask(consumer, it);
             }
         }
         else if (op == DEL_COMMAND)
@@ -138,7 +159,7 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (!m_portsOrch->getPort(alias, port))
             {
                 SWSS_LOG_ERROR("Failed to locate interface %s\n", alias.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
                 continue;
             }
 
@@ -152,6 +173,7 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (status != SAI_STATUS_SUCCESS)
             {
                 SWSS_LOG_ERROR("Failed to remove subnet route pre:%s %d\n", ip_prefix.to_string().c_str(), status);
+                it->second.m_reason = "remove subnet route failed";
                 it++;
                 continue;
             }
@@ -165,13 +187,14 @@ void IntfsOrch::doTask(Consumer &consumer)
             if (status != SAI_STATUS_SUCCESS)
             {
                 SWSS_LOG_ERROR("Failed to remove action trap route ip:%s %d\n", ip_prefix.getIp().to_string().c_str(), status);
+                it->second.m_reason = "remove trap route failed";
                 it++;
             }
             else
             {
                 SWSS_LOG_NOTICE("Remove packet action trap route ip:%s\n", ip_prefix.getIp().to_string().c_str());
                 m_intfs[alias].remove(ip_prefix.getIp());
-                it = consumer.m_toSync.erase(it);
+                it = completeTask(consumer, it);
 
                 if (!m_intfs[alias].getSize())
                 {
@@ -246,6 +269,9 @@ bool IntfsOrch::addRouterIntfs(Port &port, sai_object_id_t virtual_router_id, Ma
 
     SWSS_LOG_NOTICE("Create router interface for port %s", port.m_alias.c_str());
 
+    RouterInterfaceUpdate update = { port.m_alias };
+    notify(SUBJECT_TYPE_RIF_CHANGE, &update);
+
     return true;
 }
 
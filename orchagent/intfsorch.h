@@ -2,6 +2,7 @@
 #define SWSS_INTFSORCH_H
 
 #include "orch.h"
+#include "observer.h"
 #include "portsorch.h"
 
 #include "ipaddresses.h"
@@ -12,14 +13,20 @@
 extern sai_object_id_t gVirtualRouterId;
 extern MacAddress gMacAddress;
 
-typedef map<string, IpAddresses> IntfsTable;
+typedef CountingMap<string, IpAddresses> IntfsTable;
 
-class IntfsOrch : public Orch
+class IntfsOrch : public Orch, public Observer, public Subject
 {
 public:
     IntfsOrch(DBConnector *db, string tableName, PortsOrch *portsOrch);
+
+    void update(SubjectType type, void *cntx);
+
+    void dumpState(vector<FieldValueTuple> &fvs);
+    void getMemoryStats(vector<pair<string, const AllocStats *>> &stats);
 private:
     PortsOrch *m_portsOrch;
+    AllocStats m_intfsMemory;
     IntfsTable m_intfs;
     void doTask(Consumer &consumer);
 
@@ -0,0 +1,159 @@
+#include "introspect.h"
+
+#include "logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <system_error>
+
+using namespace std;
+using namespace swss;
+
+IntrospectServer::IntrospectServer(const string &path, function<string()> handler) :
+    m_path(path),
+    m_handler(handler)
+{
+    struct sockaddr_un addr;
+
+    if (path.size() >= sizeof(addr.sun_path))
+        throw system_error(ENAMETOOLONG, system_category());
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_socket < 0)
+        throw system_error(errno, system_category());
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    /* Left behind by a previous run */
+    unlink(path.c_str());
+
+    if (bind(m_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(m_socket, 4) < 0)
+    {
+        int err = errno;
+        close(m_socket);
+        throw system_error(err, system_category());
+    }
+}
+
+IntrospectServer::~IntrospectServer()
+{
+    close(m_socket);
+    unlink(m_path.c_str());
+}
+
+void IntrospectServer::addFd(fd_set *fd)
+{
+    FD_SET(m_socket, fd);
+}
+
+bool IntrospectServer::isMe(fd_set *fd)
+{
+    return FD_ISSET(m_socket, fd);
+}
+
+int IntrospectServer::getFd()
+{
+    return m_socket;
+}
+
+int IntrospectServer::readCache()
+{
+    return NODATA;
+}
+
+void IntrospectServer::readMe()
+{
+    while (true)
+    {
+        int client = accept4(m_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                SWSS_LOG_WARN("Failed to accept introspection client: %s\n", strerror(errno));
+            return;
+        }
+
+        /* The reply fits in the socket buffer, a client that does not read
+         * it only gets it truncated */
+        string reply = m_handler();
+        size_t done = 0;
+        while (done < reply.size())
+        {
+            ssize_t n = send(client, reply.data() + done, reply.size() - done, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                SWSS_LOG_WARN("Introspection reply truncated at %zu of %zu bytes\n", done, reply.size());
+                break;
+            }
+            done += n;
+        }
+
+        close(client);
+    }
+}
+
+static bool isJsonLiteral(const string &value)
+{
+    if (value == "true" || value == "false")
+        return true;
+
+    if (value.empty() || value.size() > 18)
+        return false;
+
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] < '0' || value[i] > '9')
+            return false;
+    }
+    return value.size() == 1 || value[0] != '0';
+}
+
+static void appendJsonString(string &out, const string &value)
+{
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else
+            out += c;
+    }
+    out += '"';
+}
+
+string toJson(const vector<FieldValueTuple> &fvs)
+{
+    string out = "{";
+    for (auto &fv : fvs)
+    {
+        if (out.size() > 1)
+            out += ",";
+        appendJsonString(out, fvField(fv));
+        out += ":";
+        if (isJsonLiteral(fvValue(fv)))
+            out += fvValue(fv);
+        else
+            appendJsonString(out, fvValue(fv));
+    }
+    out += "}";
+    return out;
+}
@@ -0,0 +1,44 @@
+#ifndef SWSS_INTROSPECT_H
+#define SWSS_INTROSPECT_H
+
+#include "selectable.h"
+#include "table.h"
+#include "common/epollselect.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace swss;
+
+#define INTROSPECT_SOCKET "/var/run/orchagent.sock"
+
+/*
+ * Unix stream socket polled along with the consumer tables. Every client
+ * that connects is sent the output of the handler and disconnected, e.g.
+ *   socat - UNIX-CONNECT:/var/run/orchagent.sock
+ * Clients are served from readMe(), so the event loop never waits on them.
+ */
+class IntrospectServer : public Selectable, public FdSelectable
+{
+public:
+    IntrospectServer(const string &path, function<string()> handler);
+    virtual ~IntrospectServer();
+
+    virtual void addFd(fd_set *fd);
+    virtual bool isMe(fd_set *fd);
+    virtual int getFd();
+    virtual int readCache();
+    virtual void readMe();
+
+private:
+    string m_path;
+    int m_socket;
+    function<string()> m_handler;
+};
+
+/* One JSON object of the fields; decimal and true/false values are not quoted */
+string toJson(const vector<FieldValueTuple> &fvs);
+
+#endif /* SWSS_INTROSPECT_H */
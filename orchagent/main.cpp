@@ -1,4 +1,11 @@
 #include "orchdaemon.h"
+#include "saiprofiler.h"
+#include "taskrecorder.h"
+#include "traceevents.h"
+#include "saibulk.h"
+#ifdef SAIMOCK
+#include "saimock/saimock.h"
+#endif
 
 #include "logger.h"
 
@@ -11,7 +18,9 @@ extern "C" {
 #include <map>
 #include <thread>
 #include <chrono>
+#include <sstream>
 
+#include <errno.h>
 #include <getopt.h>
 
 using namespace std;
@@ -31,11 +40,18 @@ sai_next_hop_api_t*         sai_next_hop_api;
 sai_next_hop_group_api_t*   sai_next_hop_group_api;
 sai_route_api_t*            sai_route_api;
 sai_lag_api_t*              sai_lag_api;
+sai_route_bulk_api_t*       sai_route_bulk_api;
 
 map<string, string> gProfileMap;
 sai_object_id_t gVirtualRouterId;
 MacAddress gMacAddress;
 
+/* Maximum number of entries popped from a consumer table per wakeup */
+int gBatchSize = DEFAULT_BATCH_SIZE;
+/* Work budget of a consumer per turn: entries, and microseconds (0: none) */
+int gTaskBudget = DEFAULT_TASK_BUDGET;
+int gTaskTimeBudget = 0;
+
 const char *test_profile_get_value (
     _In_ sai_switch_profile_id_t profile_id,
     _In_ const char *variable)
@@ -85,6 +101,13 @@ void initSaiApi()
     sai_api_query(SAI_API_ROUTE,                (void **)&sai_route_api);
     sai_api_query(SAI_API_LAG,                  (void **)&sai_lag_api);
 
+#ifdef SAIMOCK
+    sai_route_bulk_api = saimock_route_bulk_api();
+#else
+    /* libsairedis has no bulk route API, one call per route it is */
+    sai_route_bulk_api = &emulated_route_bulk_api;
+#endif
+
     sai_log_set(SAI_API_SWITCH,                 SAI_LOG_NOTICE);
     sai_log_set(SAI_API_VIRTUAL_ROUTER,         SAI_LOG_NOTICE);
     sai_log_set(SAI_API_PORT,                   SAI_LOG_NOTICE);
@@ -100,20 +123,102 @@ void initSaiApi()
 
 int main(int argc, char **argv)
 {
-    swss::Logger::getInstance().setMinPrio(swss::Logger::SWSS_DEBUG);
+    /* Successful SAI calls go to the trace ring, the log keeps the errors */
+    swss::Logger::getInstance().setMinPrio(swss::Logger::SWSS_NOTICE);
 
     SWSS_LOG_ENTER();
 
     int opt;
     sai_status_t status;
-
-    while ((opt = getopt(argc, argv, "m:h")) != -1)
+    map<string, int> priorities;
+    int starvation_limit = DEFAULT_STARVATION_LIMIT;
+    bool sai_profile = false;
+    string record_file;
+    string replay_file;
+    bool replay_realtime = true;
+    string introspect_path = INTROSPECT_SOCKET;
+    string trace_path = TRACE_RING_PATH;
+
+    while ((opt = getopt(argc, argv, "m:b:w:u:p:s:Pr:R:Fi:t:dh")) != -1)
     {
         switch (opt)
         {
         case 'm':
             gMacAddress = MacAddress(optarg);
             break;
+        case 'b':
+            gBatchSize = atoi(optarg);
+            if (gBatchSize <= 0)
+            {
+                SWSS_LOG_ERROR("Invalid batch size %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'w':
+            gTaskBudget = atoi(optarg);
+            if (gTaskBudget <= 0)
+            {
+                SWSS_LOG_ERROR("Invalid task budget %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'u':
+            gTaskTimeBudget = atoi(optarg);
+            if (gTaskTimeBudget < 0)
+            {
+                SWSS_LOG_ERROR("Invalid task time budget %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'p':
+        {
+            /* TABLE:PRIORITY[,TABLE:PRIORITY...], 0 being the most urgent */
+            stringstream ss(optarg);
+            string item;
+            while (getline(ss, item, ','))
+            {
+                size_t pos = item.find(':');
+                if (pos == string::npos || pos == 0)
+                {
+                    SWSS_LOG_ERROR("Invalid table priority %s\n", item.c_str());
+                    exit(EXIT_FAILURE);
+                }
+                priorities[item.substr(0, pos)] = atoi(item.substr(pos + 1).c_str());
+            }
+            break;
+        }
+        case 's':
+            starvation_limit = atoi(optarg);
+            if (starvation_limit < 0)
+            {
+                SWSS_LOG_ERROR("Invalid starvation limit %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'P':
+            sai_profile = true;
+            break;
+        case 'r':
+            record_file = optarg;
+            break;
+        case 'i':
+            introspect_path = optarg;
+            break;
+        case 't':
+            trace_path = optarg;
+            break;
+        case 'd':
+            swss::Logger::getInstance().setMinPrio(swss::Logger::SWSS_DEBUG);
+            break;
+#ifdef SAIMOCK
+        /* Replaying only makes sense against the in-memory SAI */
+        case 'R':
+            replay_file = optarg;
+            break;
+        case 'F':
+            replay_realtime = false;
+            break;
+#endif
         case 'h':
             exit(EXIT_SUCCESS);
         default: /* '?' */
@@ -123,7 +228,12 @@ int main(int argc, char **argv)
 
     SWSS_LOG_NOTICE("--- Starting Orchestration Agent ---\n");
 
+    if (!trace_path.empty() && !TraceRing::open(trace_path, TRACE_RING_CAPACITY))
+        SWSS_LOG_WARN("Failed to open trace ring %s, errno %d\n", trace_path.c_str(), errno);
+
     initSaiApi();
+    if (sai_profile)
+        SaiProfiler::wrapApis();
 
     SWSS_LOG_NOTICE("sai_switch_api: initializing switch\n");
     status = sai_switch_api->initialize_switch(0, "", "", &switch_notifications);
@@ -172,12 +282,27 @@ int main(int argc, char **argv)
     SWSS_LOG_NOTICE("Get switch virtual router ID %llx\n", gVirtualRouterId);
 
     OrchDaemon *orchDaemon = new OrchDaemon();
+    for (auto &it : priorities)
+        orchDaemon->setTablePriority(it.first, it.second);
+    orchDaemon->setStarvationLimit(starvation_limit);
+    orchDaemon->setIntrospectPath(introspect_path);
+
     if (!orchDaemon->init())
     {
         SWSS_LOG_ERROR("Failed to initialize orchstration daemon\n");
         exit(EXIT_FAILURE);
     }
 
+    if (!replay_file.empty())
+    {
+        if (!orchDaemon->replay(replay_file, replay_realtime))
+            exit(EXIT_FAILURE);
+        return 0;
+    }
+
+    if (!record_file.empty() && !TaskRecorder::open(record_file))
+        exit(EXIT_FAILURE);
+
     try {
         orchDaemon->start();
     }
@@ -1,6 +1,8 @@
 #include "neighorch.h"
 
 #include "logger.h"
+#include "common/probes.h"
+#include "traceevents.h"
 
 #include "assert.h"
 
@@ -12,6 +14,12 @@ bool NeighOrch::hasNextHop(IpAddress ipAddress)
     return m_syncdNextHops.find(ipAddress) != m_syncdNextHops.end();
 }
 
+bool NeighOrch::isNextHopLost(IpAddress ipAddress)
+{
+    auto it = m_syncdNextHops.find(ipAddress);
+    return it != m_syncdNextHops.end() && it->second.lost;
+}
+
 bool NeighOrch::addNextHop(IpAddress ipAddress, Port port)
 {
     SWSS_LOG_ENTER();
@@ -28,7 +36,11 @@ bool NeighOrch::addNextHop(IpAddress ipAddress, Port port)
     next_hop_attrs[2].value.oid = port.m_rif_id;
 
     sai_object_id_t next_hop_id;
+    SWSS_PROBE2(next_hop_create_entry, next_hop_attrs[1].value.ipaddr.addr.ip4, port.m_rif_id);
     sai_status_t status = sai_next_hop_api->create_next_hop(&next_hop_id, 3, next_hop_attrs);
+    SWSS_PROBE3(next_hop_create_return, next_hop_attrs[1].value.ipaddr.addr.ip4, next_hop_id, status);
+    TraceRing::record(TRACE_NEXT_HOP_CREATE, next_hop_attrs[1].value.ipaddr.addr.ip4,
+                      port.m_rif_id, next_hop_id, status);
     if (status != SAI_STATUS_SUCCESS)
     {
         SWSS_LOG_ERROR("Failed to create next hop entry ip:%s rid%llx\n",
@@ -39,11 +51,26 @@ bool NeighOrch::addNextHop(IpAddress ipAddress, Port port)
     NextHopEntry next_hop_entry;
     next_hop_entry.next_hop_id = next_hop_id;
     next_hop_entry.ref_count = 0;
+    next_hop_entry.lost = false;
     m_syncdNextHops[ipAddress] = next_hop_entry;
 
+    NextHopUpdate update = { ipAddress };
+    notify(SUBJECT_TYPE_NEXTHOP_CHANGE, &update);
+
     return true;
 }
 
+void NeighOrch::restoreNextHop(IpAddress ipAddress)
+{
+    auto it = m_syncdNextHops.find(ipAddress);
+    if (it == m_syncdNextHops.end() || !it->second.lost)
+        return;
+
+    it->second.lost = false;
+    NextHopUpdate update = { ipAddress };
+    notify(SUBJECT_TYPE_NEXTHOP_CHANGE, &update);
+}
+
 bool NeighOrch::removeNextHop(IpAddress ipAddress)
 {
     SWSS_LOG_ENTER();
@@ -82,7 +109,65 @@ void NeighOrch::increaseNextHopRefCount(IpAddress ipAddress)
 void NeighOrch::decreaseNextHopRefCount(IpAddress ipAddress)
 {
     assert(hasNextHop(ipAddress));
-    m_syncdNextHops[ipAddress].ref_count --;
+
+    NextHopEntry &next_hop = m_syncdNextHops[ipAddress];
+    next_hop.ref_count --;
+    if (next_hop.ref_count || !next_hop.lost)
+        return;
+
+    /* The last user moved away, the parked removal can go through now */
+    Consumer &consumer = m_consumerMap.at(APP_NEIGH_TABLE_NAME);
+    NeighborEntry first = { ipAddress, "" };
+    for (auto it = m_syncdNeighbors.lower_bound(first);
+         it != m_syncdNeighbors.end() && it->first.ip_address == ipAddress; it++)
+        retryTask(consumer, it->first.alias + ":" + ipAddress.to_string());
+}
+
+void NeighOrch::update(SubjectType type, void *cntx)
+{
+    Consumer &consumer = m_consumerMap.at(APP_NEIGH_TABLE_NAME);
+
+    switch (type)
+    {
+        case SUBJECT_TYPE_RIF_CHANGE:
+        {
+            /* Neighbor task keys are formatted as alias:ip */
+            RouterInterfaceUpdate *update = static_cast<RouterInterfaceUpdate *>(cntx);
+            retryTasksByPrefix(consumer, update->alias + ":");
+            break;
+        }
+        case SUBJECT_TYPE_PORT_CONFIG_DONE:
+            retryAllTasks(consumer);
+            break;
+        default:
+            break;
+    }
+}
+
+NeighborTaskCache *NeighOrch::getTaskCache(SyncTask &task)
+{
+    if (!task.m_cache)
+    {
+        const KeyOpFieldsValuesTuple &t = task.m_kfv;
+
+        const string &key = kfvKey(t);
+        size_t found = key.find(':');
+        if (found == string::npos)
+            return NULL;
+
+        auto cache = make_shared<NeighborTaskCache>();
+        cache->neighbor_entry.alias = key.substr(0, found);
+        cache->neighbor_entry.ip_address = IpAddress(key.substr(found+1));
+
+        for (auto &i : kfvFieldsValues(t))
+        {
+            if (fvField(i) == "neigh")
+                cache->mac_address = MacAddress(fvValue(i));
+        }
+        task.m_cache = cache;
+    }
+
+    return static_cast<NeighborTaskCache *>(task.m_cache.get());
 }
 
 void NeighOrch::doTask(Consumer &consumer)
@@ -95,74 +180,83 @@ void NeighOrch::doTask(Consumer &consumer)
     auto it = consumer.m_toSync.begin();
     while (it != consumer.m_toSync.end())
     {
-        KeyOpFieldsValuesTuple t = it->second;
+        const KeyOpFieldsValuesTuple &t = it->second.m_kfv;
 
-        string key = kfvKey(t);
-        size_t found = key.find(':');
-        if (found == string::npos)
+        /* Parse the key and fields once, retries reuse the decoded task */
+        NeighborTaskCache *cache = getTaskCache(it->second);
+        if (!cache)
         {
-            SWSS_LOG_ERROR("Failed to parse task key %s\n", key.c_str());
-            it = consumer.m_toSync.erase(it);
+            SWSS_LOG_ERROR("Failed to parse task key %s\n", kfvKey(t).c_str());
+            it = dropTask(consumer, it);
             continue;
         }
 
-        string alias = key.substr(0, found);
+        const NeighborEntry &neighbor_entry = cache->neighbor_entry;
         Port p;
 
-        if (!m_portsOrch->getPort(alias, p))
+        if (!m_portsOrch->getPort(neighbor_entry.alias, p))
         {
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
 
-        IpAddress ip_address(key.substr(found+1));
-        if (!ip_address.isV4())
+        if (!neighbor_entry.ip_address.isV4())
         {
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
 
-        NeighborEntry neighbor_entry = { ip_address, alias };
-
         string op = kfvOp(t);
 
         if (op == SET_COMMAND)
         {
-            MacAddress mac_address;
-            for (auto i = kfvFieldsValues(t).begin();
-                 i  != kfvFieldsValues(t).end(); i++)
+            /* Wait until the router interface is created */
+            if (!p.m_rif_id)
             {
-                if (fvField(*i) == "neigh")
-                    mac_address = MacAddress(fvValue(*i));
+                it->second.m_reason = "no router interface";
+                it++;
+                continue;
             }
 
+            const MacAddress &mac_address = cache->mac_address;
+
             if (m_syncdNeighbors.find(neighbor_entry) == m_syncdNeighbors.end() || m_syncdNeighbors[neighbor_entry] != mac_address)
             {
                 if (addNeighbor(neighbor_entry, mac_address))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "add neighbor failed";
                     it++;
+                }
             }
             else
-                it = consumer.m_toSync.erase(it);
+            {
+                /* The neighbor is back before its removal went through */
+                restoreNextHop(neighbor_entry.ip_address);
+                it = dropTask(consumer, it);
+            }
         }
         else if (op == DEL_COMMAND)
         {
             if (m_syncdNeighbors.find(neighbor_entry) != m_syncdNeighbors.end())
             {
                 if (removeNeighbor(neighbor_entry))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "remove neighbor failed";
                     it++;
+                }
             }
             else
                 /* Cannot locate the neighbor */
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
         }
         else
         {
             SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
         }
     }
 }
@@ -189,18 +283,22 @@ bool NeighOrch::addNeighbor(NeighborEntry neighborEntry, MacAddress macAddress)
 
     if (m_syncdNeighbors.find(neighborEntry) == m_syncdNeighbors.end())
     {
+        SWSS_PROBE2(neighbor_create_entry, neighbor_entry.ip_address.addr.ip4, neighbor_entry.rif_id);
         status = sai_neighbor_api->create_neighbor_entry(&neighbor_entry, 1, &neighbor_attr);
+        SWSS_PROBE3(neighbor_create_return, neighbor_entry.ip_address.addr.ip4, neighbor_entry.rif_id, status);
+        TraceRing::record(TRACE_NEIGHBOR_CREATE, neighbor_entry.ip_address.addr.ip4,
+                          neighbor_entry.rif_id, status);
         if (status != SAI_STATUS_SUCCESS)
         {
             SWSS_LOG_ERROR("Failed to create neighbor entry alias:%s ip:%s\n", alias.c_str(), ip_address.to_string().c_str());
             return false;
         }
 
-        SWSS_LOG_NOTICE("Create neighbor entry rid:%llx alias:%s ip:%s\n", p.m_rif_id, alias.c_str(), ip_address.to_string().c_str());
-
         if (!addNextHop(ip_address, p))
         {
+            SWSS_PROBE2(neighbor_remove_entry, neighbor_entry.ip_address.addr.ip4, neighbor_entry.rif_id);
             status = sai_neighbor_api->remove_neighbor_entry(&neighbor_entry);
+            SWSS_PROBE3(neighbor_remove_return, neighbor_entry.ip_address.addr.ip4, neighbor_entry.rif_id, status);
             if (status != SAI_STATUS_SUCCESS)
             {
                 SWSS_LOG_ERROR("Failed to remove neighbor entry rid:%llx alias:%s ip:%s\n", p.m_rif_id, alias.c_str(), ip_address.to_string().c_str());
@@ -212,6 +310,7 @@ bool NeighOrch::addNeighbor(NeighborEntry neighborEntry, MacAddress macAddress)
     }
     else
     {
+        restoreNextHop(ip_address);
         // TODO: The neighbor entry is already there
         // TODO: MAC change
     }
@@ -230,6 +329,17 @@ bool NeighOrch::removeNeighbor(NeighborEntry neighborEntry)
     if (m_syncdNeighbors.find(neighborEntry) == m_syncdNeighbors.end())
         return true;
 
+    /*
+     * Let the users of the next hop move away from it first; whatever
+     * still refers to it afterwards keeps the neighbor until it is gone.
+     */
+    if (m_syncdNextHops[ip_address].ref_count > 0)
+    {
+        m_syncdNextHops[ip_address].lost = true;
+        NextHopUpdate update = { ip_address };
+        notify(SUBJECT_TYPE_NEXTHOP_LOSS, &update);
+    }
+
     if (m_syncdNextHops[ip_address].ref_count > 0)
     {
         SWSS_LOG_ERROR("Neighbor is still referenced ip:%s\n", ip_address.to_string().c_str());
@@ -250,6 +360,7 @@ bool NeighOrch::removeNeighbor(NeighborEntry neighborEntry)
 
     sai_object_id_t next_hop_id = m_syncdNextHops[ip_address].next_hop_id;
     status = sai_next_hop_api->remove_next_hop(next_hop_id);
+    TraceRing::record(TRACE_NEXT_HOP_REMOVE, next_hop_id, status);
     if (status != SAI_STATUS_SUCCESS)
     {
         /* When next hop is not found, we continue to remove neighbor entry. */
@@ -265,6 +376,8 @@ bool NeighOrch::removeNeighbor(NeighborEntry neighborEntry)
     }
 
     status = sai_neighbor_api->remove_neighbor_entry(&neighbor_entry);
+    TraceRing::record(TRACE_NEIGHBOR_REMOVE, neighbor_entry.ip_address.addr.ip4,
+                      neighbor_entry.rif_id, status);
     if (status != SAI_STATUS_SUCCESS)
     {
         if (status == SAI_STATUS_ITEM_NOT_FOUND)
@@ -282,3 +395,17 @@ bool NeighOrch::removeNeighbor(NeighborEntry neighborEntry)
 
     return true;
 }
+
+void NeighOrch::dumpState(vector<FieldValueTuple> &fvs)
+{
+    fvs.push_back(FieldValueTuple("orch", "NeighOrch"));
+    fvs.push_back(FieldValueTuple("neighbors", to_string(m_syncdNeighbors.size())));
+    fvs.push_back(FieldValueTuple("next_hops", to_string(m_syncdNextHops.size())));
+}
+
+void NeighOrch::getMemoryStats(vector<pair<string, const AllocStats *>> &stats)
+{
+    Orch::getMemoryStats(stats);
+    stats.push_back(make_pair("NeighborTable", &m_neighborMemory));
+    stats.push_back(make_pair("NextHopTable", &m_nextHopMemory));
+}
@@ -2,6 +2,7 @@
 #define SWSS_NEIGHORCH_H
 
 #include "orch.h"
+#include "observer.h"
 #include "portsorch.h"
 
 #include "ipaddress.h"
@@ -21,21 +22,35 @@ struct NextHopEntry
 {
     sai_object_id_t     next_hop_id;    // next hop id
     int                 ref_count;      // reference count
+    bool                lost;           // neighbor removal pending on the references
+};
+
+/* Neighbor task decoded on its first pass */
+struct NeighborTaskCache : public TaskCache
+{
+    NeighborEntry       neighbor_entry; // neighbor IP address and alias
+    MacAddress          mac_address;    // neighbor MAC address
 };
 
 /* NeighborTable: NeighborEntry, neighbor MAC address */
-typedef map<NeighborEntry, MacAddress> NeighborTable;
+typedef CountingMap<NeighborEntry, MacAddress> NeighborTable;
 /* NextHopTable: next hop IP address, NextHopEntry */
-typedef map<IpAddress, NextHopEntry> NextHopTable;
+typedef CountingMap<IpAddress, NextHopEntry> NextHopTable;
 
-class NeighOrch : public Orch
+class NeighOrch : public Orch, public Observer, public Subject
 {
 public:
     NeighOrch(DBConnector *db, string tableName, PortsOrch *portsOrch) :
         Orch(db, tableName),
-        m_portsOrch(portsOrch) {};
+        m_portsOrch(portsOrch),
+        m_syncdNeighbors(NeighborTable::allocator_type(&m_neighborMemory)),
+        m_syncdNextHops(NextHopTable::allocator_type(&m_nextHopMemory)) {};
+
+    void update(SubjectType type, void *cntx);
 
     bool hasNextHop(IpAddress);
+    /* The neighbor of the next hop is gone, only references keep it */
+    bool isNextHopLost(IpAddress);
 
     sai_object_id_t getNextHopId(IpAddress);
     int getNextHopRefCount(IpAddress);
@@ -43,18 +58,27 @@ public:
     void increaseNextHopRefCount(IpAddress);
     void decreaseNextHopRefCount(IpAddress);
 
+    void dumpState(vector<FieldValueTuple> &fvs);
+    void getMemoryStats(vector<pair<string, const AllocStats *>> &stats);
+
 private:
     PortsOrch *m_portsOrch;
 
+    AllocStats m_neighborMemory;
+    AllocStats m_nextHopMemory;
     NeighborTable m_syncdNeighbors;
     NextHopTable m_syncdNextHops;
 
     bool addNextHop(IpAddress, Port);
     bool removeNextHop(IpAddress);
+    /* Tell the users of a lost next hop that its neighbor is back */
+    void restoreNextHop(IpAddress);
 
     bool addNeighbor(NeighborEntry, MacAddress);
     bool removeNeighbor(NeighborEntry);
 
+    NeighborTaskCache *getTaskCache(SyncTask &task);
+
     void doTask(Consumer &consumer);
 };
 
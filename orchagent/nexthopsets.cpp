@@ -0,0 +1,115 @@
+#include "nexthopsets.h"
+
+#include <algorithm>
+#include <string>
+
+NextHopSetPool::NextHopSetPool() :
+    m_sets(1, NextHopSet(), CountingAllocator<NextHopSet>(&m_memory)),
+    m_free(CountingAllocator<NextHopSetId>(&m_memory)),
+    m_index(0, hash<size_t>(), equal_to<size_t>(), IndexAllocator(&m_memory)),
+    m_byNextHop(CountingMap<IpAddress, vector<NextHopSetId>>::allocator_type(&m_memory))
+{
+}
+
+size_t NextHopSetPool::hashOf(const IpAddresses &ipAddresses)
+{
+    size_t h = 0;
+
+    for (auto &ip : ipAddresses.getIpAddresses())
+    {
+        size_t v = ip.isV4() ? hash<uint32_t>()(ip.getV4Addr()) : hash<string>()(ip.to_string());
+        h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+
+    return h;
+}
+
+NextHopSetId NextHopSetPool::find(const IpAddresses &ipAddresses) const
+{
+    size_t h = hashOf(ipAddresses);
+    auto range = m_index.equal_range(h);
+
+    for (auto it = range.first; it != range.second; it++)
+    {
+        if (m_sets[it->second].ip_addresses == ipAddresses)
+            return it->second;
+    }
+
+    return NEXT_HOP_SET_NONE;
+}
+
+NextHopSetId NextHopSetPool::intern(const IpAddresses &ipAddresses)
+{
+    NextHopSetId id = find(ipAddresses);
+    if (id != NEXT_HOP_SET_NONE)
+        return id;
+
+    if (m_free.empty())
+    {
+        id = (NextHopSetId)m_sets.size();
+        m_sets.emplace_back();
+    }
+    else
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+
+    NextHopSet &set = m_sets[id];
+    set.ip_addresses = ipAddresses;
+    set.hash = hashOf(ipAddresses);
+    set.ref_count = 0;
+    set.next_hop_group_id = 0;
+    set.pruned.clear();
+    m_index.emplace(set.hash, id);
+    for (auto &ip : ipAddresses.getIpAddresses())
+        m_byNextHop[ip].push_back(id);
+
+    return id;
+}
+
+vector<NextHopSetId> NextHopSetPool::getSetsByNextHop(const IpAddress &ip) const
+{
+    auto it = m_byNextHop.find(ip);
+    if (it == m_byNextHop.end())
+        return vector<NextHopSetId>();
+
+    return it->second;
+}
+
+void NextHopSetPool::collect(NextHopSetId id)
+{
+    NextHopSet &set = m_sets[id];
+    if (set.ref_count != 0 || set.next_hop_group_id)
+        return;
+
+    auto range = m_index.equal_range(set.hash);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        if (it->second == id)
+        {
+            m_index.erase(it);
+            break;
+        }
+    }
+
+    for (auto &ip : set.ip_addresses.getIpAddresses())
+    {
+        auto it = m_byNextHop.find(ip);
+        if (it == m_byNextHop.end())
+            continue;
+
+        auto &ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), id);
+        if (pos != ids.end())
+            ids.erase(pos);
+        if (ids.empty())
+            m_byNextHop.erase(it);
+    }
+
+    /* Release the addresses now, the slot may stay free for long */
+    set.ip_addresses = IpAddresses();
+    set.pruned.clear();
+    set.ref_count = -1;
+    m_free.push_back(id);
+}
@@ -0,0 +1,78 @@
+#ifndef SWSS_NEXTHOPSETS_H
+#define SWSS_NEXTHOPSETS_H
+
+extern "C" {
+#include "sai.h"
+}
+
+#include "ipaddresses.h"
+#include "common/countingallocator.h"
+
+#include <stdint.h>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace swss;
+
+/* Handle of an interned next hop set, NEXT_HOP_SET_NONE is never handed out */
+typedef uint32_t NextHopSetId;
+#define NEXT_HOP_SET_NONE   0
+
+struct NextHopSet
+{
+    IpAddresses         ip_addresses;       // next hop IP address(es)
+    size_t              hash;
+    int                 ref_count;          // routes holding the handle, -1 once freed
+    sai_object_id_t     next_hop_group_id;  // next hop group of a set of several next hops, 0 if none
+    set<IpAddress>      pruned;             // lost next hops taken out of the group
+};
+
+/*
+ * Next hop sets interned once, so that routes hold a handle instead of a
+ * copy of their set and compare by handle. An entry is freed, and its
+ * handle reused, once no route refers to it and it has no next hop group;
+ * the owner calls collect() whenever either may have dropped.
+ */
+class NextHopSetPool
+{
+public:
+    NextHopSetPool();
+
+    /* Handle of ipAddresses, NEXT_HOP_SET_NONE if it is not interned */
+    NextHopSetId find(const IpAddresses &ipAddresses) const;
+    /* Handle of ipAddresses, interned with no reference if needed */
+    NextHopSetId intern(const IpAddresses &ipAddresses);
+    /* Free the entry if nothing holds it anymore */
+    void collect(NextHopSetId id);
+
+    /* References are invalidated by intern() */
+    NextHopSet &get(NextHopSetId id) { return m_sets[id]; }
+    const NextHopSet &get(NextHopSetId id) const { return m_sets[id]; }
+    size_t size() const { return m_index.size(); }
+    /* Highest handle handed out so far */
+    NextHopSetId maxId() const { return (NextHopSetId)m_sets.size() - 1; }
+
+    /* Handles of the interned sets containing ip */
+    vector<NextHopSetId> getSetsByNextHop(const IpAddress &ip) const;
+
+    const AllocStats *getMemoryStats() const { return &m_memory; }
+
+private:
+    typedef CountingAllocator<pair<const size_t, NextHopSetId>> IndexAllocator;
+
+    AllocStats m_memory;
+    /* Entries by handle, the first one is unused */
+    vector<NextHopSet, CountingAllocator<NextHopSet>> m_sets;
+    vector<NextHopSetId, CountingAllocator<NextHopSetId>> m_free;
+    /* Handles by hash of their set */
+    unordered_multimap<size_t, NextHopSetId, hash<size_t>, equal_to<size_t>, IndexAllocator> m_index;
+    /* Handles by next hop, the lists are not accounted for */
+    CountingMap<IpAddress, vector<NextHopSetId>> m_byNextHop;
+
+    static size_t hashOf(const IpAddresses &ipAddresses);
+};
+
+#endif /* SWSS_NEXTHOPSETS_H */
@@ -0,0 +1,68 @@
+#ifndef SWSS_OBSERVER_H
+#define SWSS_OBSERVER_H
+
+#include <list>
+#include <string>
+
+#include "ipaddress.h"
+
+using namespace std;
+using namespace swss;
+
+enum SubjectType
+{
+    SUBJECT_TYPE_NEXTHOP_CHANGE,
+    SUBJECT_TYPE_NEXTHOP_LOSS,
+    SUBJECT_TYPE_RIF_CHANGE,
+    SUBJECT_TYPE_PORT_CONFIG_DONE,
+};
+
+/*
+ * Context of SUBJECT_TYPE_NEXTHOP_CHANGE: a next hop has been created, or
+ * is back after a loss; of SUBJECT_TYPE_NEXTHOP_LOSS: the neighbor of a next
+ * hop still in use is being removed
+ */
+struct NextHopUpdate
+{
+    IpAddress           ip_address;     // next hop IP address
+};
+
+/* Context of SUBJECT_TYPE_RIF_CHANGE: a router interface has been created */
+struct RouterInterfaceUpdate
+{
+    string              alias;          // interface alias
+};
+
+class Observer
+{
+public:
+    virtual void update(SubjectType type, void *cntx) = 0;
+    virtual ~Observer() {}
+};
+
+class Subject
+{
+public:
+    virtual void attach(Observer *observer)
+    {
+        m_observers.push_back(observer);
+    }
+
+    virtual void detach(Observer *observer)
+    {
+        m_observers.remove(observer);
+    }
+
+    virtual ~Subject() {}
+
+protected:
+    list<Observer *> m_observers;
+
+    virtual void notify(SubjectType type, void *cntx)
+    {
+        for (auto iter : m_observers)
+            iter->update(type, cntx);
+    }
+};
+
+#endif /* SWSS_OBSERVER_H */
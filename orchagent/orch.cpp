@@ -1,17 +1,28 @@
 #include "orch.h"
+#include "retrywheel.h"
+#include "taskrecorder.h"
 #include "logger.h"
+#include "common/probes.h"
+
+#include <chrono>
 
 using namespace swss;
 
+extern int gBatchSize;
+extern int gTaskBudget;
+extern int gTaskTimeBudget;
+
 Orch::Orch(DBConnector *db, string tableName) :
-    m_db(db)
+    m_db(db),
+    m_retryWheel(NULL)
 {
     Consumer consumer(new ConsumerTable(m_db, tableName));
     m_consumerMap.insert(ConsumerMapPair(tableName, consumer));
 }
 
 Orch::Orch(DBConnector *db, vector<string> &tableNames) :
-    m_db(db)
+    m_db(db),
+    m_retryWheel(NULL)
 {
     for(auto it : tableNames) {
         Consumer consumer(new ConsumerTable(m_db, it));
@@ -30,15 +41,24 @@ Orch::~Orch()
 std::vector<Selectable *> Orch::getSelectables()
 {
     std::vector<Selectable *> selectables;
-    for(auto it : m_consumerMap) {
+    for(auto &it : m_consumerMap) {
         selectables.push_back(it.second.m_consumer);
     }
     return selectables;
 }
 
+std::vector<Consumer *> Orch::getConsumers()
+{
+    std::vector<Consumer *> consumers;
+    for(auto &it : m_consumerMap) {
+        consumers.push_back(&it.second);
+    }
+    return consumers;
+}
+
 bool Orch::hasSelectable(ConsumerTable *selectable) const
 {
-    for(auto it : m_consumerMap) {
+    for(auto &it : m_consumerMap) {
         if(it.second.m_consumer == selectable) {
             return true;
         }
@@ -46,22 +66,37 @@ bool Orch::hasSelectable(ConsumerTable *selectable) const
     return false;
 }
 
-bool Orch::execute(string tableName)
+void SyncTask::merge(KeyOpFieldsValuesTuple &kfv)
 {
-    SWSS_LOG_ENTER();
+    auto &values = kfvFieldsValues(m_kfv);
 
-    auto consumer_it = m_consumerMap.find(tableName);
-    if(consumer_it == m_consumerMap.end()) {
-        SWSS_LOG_ERROR("Unrecognized tableName:%s\n", tableName.c_str());
-        return false;
+    if (m_fieldIndex.empty())
+    {
+        for (size_t i = 0; i < values.size(); i++)
+            m_fieldIndex[fvField(values[i])] = i;
     }
-    Consumer& consumer = consumer_it->second;
 
-    KeyOpFieldsValuesTuple new_data;
-    consumer.m_consumer->pop(new_data);
+    m_cache.reset();
+    kfvOp(m_kfv) = kfvOp(kfv);
+    for (auto &fv : kfvFieldsValues(kfv))
+    {
+        auto it = m_fieldIndex.find(fvField(fv));
+        if (it != m_fieldIndex.end())
+        {
+            fvValue(values[it->second]) = move(fvValue(fv));
+        }
+        else
+        {
+            m_fieldIndex[fvField(fv)] = values.size();
+            values.push_back(move(fv));
+        }
+    }
+}
 
-    string key = kfvKey(new_data);
-    string op  = kfvOp(new_data);
+void Orch::addToSync(Consumer &consumer, KeyOpFieldsValuesTuple &new_data)
+{
+    const string &key = kfvKey(new_data);
+    const string &op  = kfvOp(new_data);
 
 #ifdef DEBUG
     string debug = "Table : " + consumer.m_consumer.getTableName() + " key : " + kfvKey(new_data) + " op : "  + kfvOp(new_data);
@@ -70,50 +105,288 @@ bool Orch::execute(string tableName)
     SWSS_LOG_DEBUG("%s\n", debug.c_str());
 #endif
 
+    /* An update to a parked entry makes it eligible for the next pass again */
+    auto parked = consumer.m_toRetry.find(key);
+    if (parked != consumer.m_toRetry.end())
+        unparkTask(consumer, parked);
+
+    /* An entry set aside by doIncrementalTask is updated where it is */
+    SyncMap &toSync = consumer.m_backlog.find(key) != consumer.m_backlog.end() ?
+                      consumer.m_backlog : consumer.m_toSync;
+
     /* If a new task comes or if a DEL task comes, we directly put it into consumer.m_toSync map */
-    if ( consumer.m_toSync.find(key) == consumer.m_toSync.end() || op == DEL_COMMAND)
+    auto it = toSync.find(key);
+    if (it == toSync.end())
+    {
+        string k = key;
+        auto res = toSync.emplace(move(k), move(new_data));
+        res.first->second.m_popTime = chrono::steady_clock::now();
+        res.first->second.m_updateTime = res.first->second.m_popTime;
+    }
+    else if (op == DEL_COMMAND)
     {
-       consumer.m_toSync[key] = new_data;
+        consumer.m_stats.merges++;
+        it->second = move(new_data);
+        it->second.m_popTime = chrono::steady_clock::now();
+        it->second.m_updateTime = it->second.m_popTime;
     }
-    /* If an old task is still there, we combine the old task with new task */
+    /* If an old task is still there, we merge the new fields into it in place */
     else
     {
-        KeyOpFieldsValuesTuple existing_data = consumer.m_toSync[key];
+        consumer.m_stats.merges++;
+        it->second.merge(new_data);
+        it->second.m_updateTime = chrono::steady_clock::now();
+        /* Like a DEL, the update starts over from the initial backoff */
+        it->second.m_attempts = 0;
+        it->second.m_reason = NULL;
+    }
+}
 
-        auto new_values = kfvFieldsValues(new_data);
-        auto existing_values = kfvFieldsValues(existing_data);
+void Orch::addTask(Consumer &consumer, KeyOpFieldsValuesTuple &entry)
+{
+    addToSync(consumer, entry);
+    consumer.m_stats.pops++;
+}
 
+bool Orch::execute(Consumer &consumer)
+{
+    SWSS_LOG_ENTER();
 
-        for (auto it : new_values)
-        {
-            string field = fvField(it);
-            string value = fvValue(it);
+    /*
+     * Drain every entry already queued in the consumer table (up to
+     * gBatchSize) into consumer.m_toSync. doTask is run afterwards, on the
+     * consumer's turn in OrchDaemon::schedule, so that a burst of updates
+     * costs one pass over m_toSync instead of one per entry.
+     */
+    int count = 0;
+    do
+    {
+        KeyOpFieldsValuesTuple new_data;
+        consumer.m_consumer->pop(new_data);
+        SWSS_PROBE3(task_pop, consumer.m_tableName.c_str(),
+                    kfvKey(new_data).c_str(), kfvOp(new_data).c_str());
+        if (TaskRecorder::isEnabled())
+            TaskRecorder::record(consumer.m_tableName, new_data);
+        addTask(consumer, new_data);
+        count++;
+    }
+    while (count < gBatchSize &&
+           consumer.m_consumer->readCache() == Selectable::DATA);
 
-            auto iu = existing_values.begin();
-            while (iu != existing_values.end())
+    return true;
+}
+
+void Orch::doIncrementalTask(Consumer &consumer)
+{
+    if (!consumer.hasWork())
+        return;
+
+    /*
+     * Hand doTask at most gTaskBudget entries, TASK_CHUNK_SIZE at a time,
+     * and stop early once gTaskTimeBudget microseconds are spent. The rest
+     * waits in m_backlog, where addToSync and doTask still see it, and goes
+     * back to m_toSync for the next turn of this consumer.
+     */
+    auto start = chrono::steady_clock::now();
+    SyncMap &backlog = consumer.m_backlog;
+    backlog.swap(consumer.m_toSync);
+
+    /* doTask gets at least one call, if only for its pending work */
+    int &budget = consumer.m_budget;
+    budget = gTaskBudget;
+    do
+    {
+        auto now = chrono::steady_clock::now();
+        auto it = backlog.begin();
+        for (int i = 0; i < TASK_CHUNK_SIZE && i < budget && it != backlog.end(); i++)
+        {
+            SyncTask &task = it->second;
+            if (!task.m_dispatched)
             {
-                string ofield = fvField(*iu);
-                if (field == ofield)
-                    iu = existing_values.erase(iu);
-                else
-                    iu++;
+                task.m_dispatched = true;
+                if (task.m_popTime != chrono::steady_clock::time_point())
+                    consumer.m_stats.queueWait.add(TaskStats::getSec(now),
+                            chrono::duration_cast<chrono::nanoseconds>(now - task.m_popTime).count());
             }
-            existing_values.push_back(FieldValueTuple(field, value));
+
+            consumer.m_toSync.emplace_hint(consumer.m_toSync.end(), it->first, move(task));
+            it = backlog.erase(it);
         }
-        consumer.m_toSync[key] = KeyOpFieldsValuesTuple(key, op, existing_values);
+        budget -= TASK_CHUNK_SIZE;
+
+        doTaskPass(consumer);
+
+        if (gTaskTimeBudget > 0 &&
+            chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - start).count() >= gTaskTimeBudget)
+            break;
     }
+    while (!backlog.empty() && budget > 0);
+
+    consumer.m_toSync.swap(backlog);
+    budget = 0;
+}
 
-    if (!consumer.m_toSync.empty())
+void Orch::doTaskPass(Consumer &consumer)
+{
+    /*
+     * Run another pass when doTask itself re-queued parked entries, as those
+     * may sort before the entry that triggered the retry.
+     */
+    do
+    {
+        consumer.m_retryPending = false;
+
+        SWSS_PROBE2(do_task_entry, consumer.m_tableName.c_str(), consumer.m_toSync.size());
         doTask(consumer);
+        SWSS_PROBE2(do_task_return, consumer.m_tableName.c_str(), consumer.m_toSync.size());
+    }
+    while (consumer.m_retryPending && !consumer.m_toSync.empty());
 
-    return true;
+    /*
+     * Whatever is left in m_toSync could not be synced in this pass. Park it
+     * in m_toRetry so that later passes only revisit new or changed entries,
+     * and retry it once its backoff has elapsed, unless a notification
+     * retries it first.
+     */
+    auto now = m_retryWheel ? m_retryWheel->now() : chrono::steady_clock::now();
+    for (auto &it : consumer.m_toSync)
+    {
+        SyncTask &task = it.second;
+        int backoff = RETRY_BACKOFF_INITIAL << min(task.m_attempts, 16);
+        if (backoff > RETRY_BACKOFF_MAX)
+            backoff = RETRY_BACKOFF_MAX;
+
+        task.m_attempts++;
+        if (task.m_popTime != chrono::steady_clock::time_point())
+            consumer.m_stats.failures++;
+        task.m_nextRetry = now + chrono::milliseconds(backoff);
+        if (m_retryWheel)
+            m_retryWheel->schedule(this, &consumer, it.first, task.m_nextRetry);
+
+        const char *reason = task.m_reason ? task.m_reason : "unknown";
+        consumer.m_parkedReasons[reason]++;
+        consumer.m_parkedAttempts[task.m_attempts]++;
+
+        SWSS_LOG_INFO("Retry %s:%s in %d ms, attempt %d (%s)\n",
+                      consumer.m_tableName.c_str(), it.first.c_str(),
+                      backoff, task.m_attempts, reason);
+    }
+
+    if (consumer.m_toRetry.empty())
+    {
+        consumer.m_toRetry.swap(consumer.m_toSync);
+        return;
+    }
+
+    for (auto &it : consumer.m_toSync)
+        consumer.m_toRetry[it.first] = move(it.second);
+    consumer.m_toSync.clear();
+}
+
+SyncMap::iterator Orch::completeTask(Consumer &consumer, SyncMap::iterator it)
+{
+    const SyncTask &task = it->second;
+
+    /* Entries doTask queued itself were never popped and are not accounted */
+    if (task.m_popTime != chrono::steady_clock::time_point())
+    {
+        auto now = chrono::steady_clock::now();
+        consumer.m_stats.retries.add(TaskStats::getSec(now), task.m_attempts);
+        consumer.m_stats.programmed.add(TaskStats::getSec(now),
+                chrono::duration_cast<chrono::nanoseconds>(now - task.m_popTime).count());
+    }
+    return consumer.m_toSync.erase(it);
+}
+
+SyncMap::iterator Orch::dropTask(Consumer &consumer, SyncMap::iterator it)
+{
+    if (it->second.m_popTime != chrono::steady_clock::time_point())
+        consumer.m_stats.drops++;
+    return consumer.m_toSync.erase(it);
+}
+
+void Orch::setRetryWheel(RetryWheel *wheel)
+{
+    m_retryWheel = wheel;
+}
+
+SyncMap::iterator Orch::unparkTask(Consumer &consumer, SyncMap::iterator it)
+{
+    const SyncTask &task = it->second;
+
+    consumer.m_parkedReasons[task.m_reason ? task.m_reason : "unknown"]--;
+    auto attempts = consumer.m_parkedAttempts.find(task.m_attempts);
+    if (--attempts->second == 0)
+        consumer.m_parkedAttempts.erase(attempts);
+
+    consumer.m_toSync[it->first] = move(it->second);
+    return consumer.m_toRetry.erase(it);
 }
 
-void Orch::doTask()
+void Orch::retryDueTask(Consumer &consumer, const string &key,
+                        chrono::steady_clock::time_point now)
 {
-    for(auto &it : m_consumerMap)
+    auto it = consumer.m_toRetry.find(key);
+    if (it == consumer.m_toRetry.end() || it->second.m_nextRetry > now)
+        return;
+
+    unparkTask(consumer, it);
+}
+
+void Orch::retryTask(Consumer &consumer, const string &key)
+{
+    auto it = consumer.m_toRetry.find(key);
+    if (it == consumer.m_toRetry.end())
+        return;
+
+    unparkTask(consumer, it);
+    consumer.m_retryPending = true;
+}
+
+void Orch::retryTasksByPrefix(Consumer &consumer, const string &prefix)
+{
+    auto it = consumer.m_toRetry.lower_bound(prefix);
+    while (it != consumer.m_toRetry.end() &&
+           it->first.compare(0, prefix.size(), prefix) == 0)
     {
-        if (!it.second.m_toSync.empty())
-            doTask(it.second);
+        it = unparkTask(consumer, it);
+        consumer.m_retryPending = true;
     }
 }
+
+void Orch::retryAllTasks(Consumer &consumer)
+{
+    if (consumer.m_toRetry.empty())
+        return;
+
+    for (auto &it : consumer.m_toRetry)
+        consumer.m_toSync[it.first] = move(it.second);
+    consumer.m_toRetry.clear();
+    for (auto &r : consumer.m_parkedReasons)
+        r.second = 0;
+    consumer.m_parkedAttempts.clear();
+    consumer.m_retryPending = true;
+}
+
+void Orch::getMemoryStats(vector<pair<string, const AllocStats *>> &stats)
+{
+    for (auto &it : m_consumerMap)
+        stats.push_back(make_pair(it.first, it.second.m_memory.get()));
+}
+
+void Orch::doPendingTask()
+{
+    for (auto &it : m_consumerMap)
+        doIncrementalTask(it.second);
+}
+
+bool Orch::hasPendingTask() const
+{
+    for (auto &it : m_consumerMap)
+    {
+        if (it.second.hasWork())
+            return true;
+    }
+    return false;
+}
@@ -9,22 +9,146 @@ extern "C" {
 #include "dbconnector.h"
 #include "consumertable.h"
 #include "producertable.h"
+#include "common/histogram.h"
+#include "common/countingallocator.h"
 
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+
+/* Maximum number of entries drained from a consumer table per execute */
+#define DEFAULT_BATCH_SIZE 128
+/* Maximum number of entries handed to doTask per turn of a consumer */
+#define DEFAULT_TASK_BUDGET 1024
+/* Number of entries handed to doTask between two checks of the time budget */
+#define TASK_CHUNK_SIZE 64
+/* Backoff of a failed entry, doubled on every failed attempt (ms) */
+#define RETRY_BACKOFF_INITIAL   100
+#define RETRY_BACKOFF_MAX       30000
+/* Task lifecycle histograms are kept for TASK_STATS_SLOTS windows of TASK_STATS_SLOT_SEC seconds */
+#define TASK_STATS_SLOTS        6
+#define TASK_STATS_SLOT_SEC     10
 
 using namespace std;
 using namespace swss;
 
-typedef map<string, KeyOpFieldsValuesTuple> SyncMap;
+/* Decoded form of a task that an Orch keeps across its retries */
+struct TaskCache
+{
+    virtual ~TaskCache() { }
+};
+
+/*
+ * A pending task: the 'golden' tuple of a key plus the position of each of
+ * its fields, so that a newer update of the same key is merged in place.
+ * The field index is only built when the first merge happens. m_cache is
+ * owned by the Orch of the consumer and dropped whenever the tuple changes.
+ */
+struct SyncTask
+{
+    SyncTask() : m_attempts(0), m_reason(NULL), m_dispatched(false) { }
+    SyncTask(const KeyOpFieldsValuesTuple &kfv) : m_kfv(kfv), m_attempts(0), m_reason(NULL), m_dispatched(false) { }
+    SyncTask(KeyOpFieldsValuesTuple &&kfv) : m_kfv(move(kfv)), m_attempts(0), m_reason(NULL), m_dispatched(false) { }
+    operator const KeyOpFieldsValuesTuple &() const { return m_kfv; }
+
+    /* Take the operation of kfv and overwrite or append its fields */
+    void merge(KeyOpFieldsValuesTuple &kfv);
+
+    KeyOpFieldsValuesTuple m_kfv;
+    unordered_map<string, size_t> m_fieldIndex;
+    shared_ptr<TaskCache> m_cache;
+
+    /* Failed passes so far, and when the entry may be retried again */
+    int m_attempts;
+    chrono::steady_clock::time_point m_nextRetry;
+    /* Why doTask left the entry in m_toSync, set by the Orch */
+    const char *m_reason;
+
+    /* When the entry was first popped, and whether doTask has seen it yet */
+    chrono::steady_clock::time_point m_popTime;
+    bool m_dispatched;
+    /* When the update last merged into the entry was popped */
+    chrono::steady_clock::time_point m_updateTime;
+};
+
+typedef CountingMap<string, SyncTask> SyncMap;
+
+/* Lifecycle statistics of the tasks of a consumer table */
+struct TaskStats
+{
+    typedef WindowedHistogram<TASK_STATS_SLOTS> Histogram;
+
+    TaskStats() : pops(0), merges(0), drops(0), failures(0),
+        queueWait(TASK_STATS_SLOT_SEC), retries(TASK_STATS_SLOT_SEC), programmed(TASK_STATS_SLOT_SEC) { }
+
+    /* Time of the histogram windows */
+    static uint64_t getSec(chrono::steady_clock::time_point now)
+    {
+        return chrono::duration_cast<chrono::seconds>(now.time_since_epoch()).count();
+    }
+
+    /* Counters since start */
+    uint64_t            pops;           // entries popped from the table
+    uint64_t            merges;         // entries coalesced into a pending one
+    uint64_t            drops;          // entries discarded by doTask, duplicates and no-ops included
+    uint64_t            failures;       // passes that left an entry pending
+    /* Histograms of the last window */
+    Histogram           queueWait;      // pop to first doTask pass (ns)
+    Histogram           retries;        // failed passes before completion
+    Histogram           programmed;     // pop to completion (ns)
+};
+
 struct Consumer {
-    Consumer(ConsumerTable* consumer) :m_consumer(consumer)  { }
+    Consumer(ConsumerTable* consumer) :
+        m_consumer(consumer),
+        m_tableName(consumer->getTableName()),
+        m_memory(make_shared<AllocStats>()),
+        m_toSync(SyncMap::allocator_type(m_memory.get())),
+        m_toRetry(SyncMap::allocator_type(m_memory.get())),
+        m_backlog(SyncMap::allocator_type(m_memory.get())),
+        m_retryPending(false),
+        m_workPending(false),
+        m_budget(0) { }
+
+    /* Entries to sync, or work of doTask's own left over */
+    bool hasWork() const { return !m_toSync.empty() || m_workPending; }
+
     ConsumerTable* m_consumer;
-    /* Store the latest 'golden' status */
+    /* Name of m_consumer, getTableName() returns a copy */
+    string m_tableName;
+    /* Nodes of the maps below, shared by the copies of the consumer */
+    shared_ptr<AllocStats> m_memory;
+    /* Store the latest 'golden' status of entries touched since the last pass
+     * and not yet handed to doTask */
     SyncMap m_toSync;
+    /* Store the entries that failed in a previous pass until their backoff
+     * timer fires or a notification retries them */
+    SyncMap m_toRetry;
+    /* Entries of m_toSync set aside by doIncrementalTask while doTask runs
+     * on the chunk before them, empty otherwise */
+    SyncMap m_backlog;
+    /* Entries of m_toRetry per reason, kept while parking and unparking
+     * them; a reason that no longer applies stays at 0 */
+    map<string, size_t> m_parkedReasons;
+    /* Entries of m_toRetry per number of failed attempts */
+    map<int, size_t> m_parkedAttempts;
+    /* Parked entries were moved back to m_toSync while doTask was running */
+    bool m_retryPending;
+    /* doTask has work left beyond m_toSync, such as a sweep done in slices,
+     * and wants turns until it clears the flag */
+    bool m_workPending;
+    /* Entries left to this turn of the consumer, see doIncrementalTask. Work
+     * of doTask's own takes from it too */
+    int m_budget;
+
+    TaskStats m_stats;
 };
 typedef std::pair<string, Consumer> ConsumerMapPair;
 typedef map<string, Consumer> ConsumerMap;
 
+class RetryWheel;
+
 class Orch
 {
 public:
@@ -33,17 +157,54 @@ public:
     virtual ~Orch();
 
     std::vector<Selectable*> getSelectables();
+    std::vector<Consumer*> getConsumers();
     bool hasSelectable(ConsumerTable* s) const;
 
-    bool execute(string tableName);
-    /* Iterate all consumers in m_consumerMap and run doTask(Consumer) */
-    void doTask();
+    /* Pop the entries queued in the consumer table into consumer.m_toSync */
+    bool execute(Consumer &consumer);
+    /* Merge an entry into consumer.m_toSync as if it was popped from its table */
+    void addTask(Consumer &consumer, KeyOpFieldsValuesTuple &entry);
+    /* Give every consumer with entries in m_toSync one turn within its budget */
+    void doPendingTask();
+    /* Run doTask against consumer.m_toSync within the work budget and park
+     * the failed entries */
+    void doIncrementalTask(Consumer &consumer);
+    bool hasPendingTask() const;
+
+    /* Arm a timer on wheel for every entry parked with a backoff */
+    void setRetryWheel(RetryWheel *wheel);
+    /* Retry a parked entry if its backoff has elapsed by now */
+    void retryDueTask(Consumer &consumer, const string &key,
+                      chrono::steady_clock::time_point now);
+
+    /* Append the orch name and the size of its synced state to fvs */
+    virtual void dumpState(vector<FieldValueTuple> &fvs) {}
+    /* Append the live memory of the consumers and of the orch's tables */
+    virtual void getMemoryStats(vector<pair<string, const AllocStats *>> &stats);
 protected:
     /* Run doTask against a specific consumer */
     virtual void doTask(Consumer &consumer) = 0;
+
+    /* Move parked entries back to m_toSync so that the next pass retries them */
+    void retryTask(Consumer &consumer, const string &key);
+    void retryTasksByPrefix(Consumer &consumer, const string &prefix);
+    void retryAllTasks(Consumer &consumer);
+
+    /* Erase an entry that doTask has programmed, accounting for its lifecycle */
+    SyncMap::iterator completeTask(Consumer &consumer, SyncMap::iterator it);
+    /* Erase an entry that doTask discards without programming it */
+    SyncMap::iterator dropTask(Consumer &consumer, SyncMap::iterator it);
 private:
 
     DBConnector *m_db;
+    RetryWheel *m_retryWheel;
+
+    /* Move a parked entry back to consumer.m_toSync */
+    SyncMap::iterator unparkTask(Consumer &consumer, SyncMap::iterator it);
+    /* Merge a popped entry into consumer.m_toSync */
+    void addToSync(Consumer &consumer, KeyOpFieldsValuesTuple &entry);
+    /* Run doTask once against consumer.m_toSync and park what is left */
+    void doTaskPass(Consumer &consumer);
 
 protected:
     ConsumerMap m_consumerMap;
@@ -0,0 +1,640 @@
+/*
+ * orchbench drives PortsOrch, IntfsOrch, NeighOrch and RouteOrch in-process
+ * against the in-memory SAI of saimock/. Entries are handed to the orchs
+ * through Orch::addTask, the way Orch::execute does after a pop, and the
+ * consumers get their turns the way OrchDaemon schedules them.
+ *
+ * After N ports, their interfaces and M neighbors are set up, R routes are
+ * added, withdrawn, added again and resynced, then the first neighbor fails
+ * and comes back. Every phase reports the routes per second, the peak size
+ * of the consumer's m_toSync and the RSS.
+ *
+ * A merge phase times updates of a pending wide port entry, merged in place
+ * by Orch::addTask against the copy-and-erase merge it replaced. Before the
+ * routes, a dispatch phase times the lookup of the route
+ * consumer by its selectable plus Orch::execute on one popped entry, with
+ * m_toSync empty and then holding every route.
+ *
+ * The orchs still open their consumer tables, so a redis server must be
+ * listening on localhost:6379. They use database BENCH_DB, where only the
+ * dispatch phase writes, to ROUTE_TABLE.
+ */
+
+#include "orch.h"
+#include "portsorch.h"
+#include "intfsorch.h"
+#include "neighorch.h"
+#include "routeorch.h"
+#include "saimock/saimock.h"
+
+#include "logger.h"
+#include "producertable.h"
+
+extern "C" {
+#include "sai.h"
+#include "saistatus.h"
+}
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+using namespace std;
+using namespace swss;
+
+sai_switch_api_t*           sai_switch_api;
+sai_virtual_router_api_t*   sai_virtual_router_api;
+sai_port_api_t*             sai_port_api;
+sai_vlan_api_t*             sai_vlan_api;
+sai_router_interface_api_t* sai_router_intfs_api;
+sai_hostif_api_t*           sai_hostif_api;
+sai_neighbor_api_t*         sai_neighbor_api;
+sai_next_hop_api_t*         sai_next_hop_api;
+sai_next_hop_group_api_t*   sai_next_hop_group_api;
+sai_route_api_t*            sai_route_api;
+sai_lag_api_t*              sai_lag_api;
+sai_route_bulk_api_t*       sai_route_bulk_api;
+
+sai_object_id_t gVirtualRouterId;
+MacAddress gMacAddress;
+
+int gBatchSize = DEFAULT_BATCH_SIZE;
+int gTaskBudget = DEFAULT_TASK_BUDGET;
+int gTaskTimeBudget = 0;
+
+#define DEFAULT_PORTS       32
+#define DEFAULT_NEIGHBORS   256
+#define DEFAULT_ROUTES      100000
+#define DEFAULT_GROUPS      16
+#define DEFAULT_ECMP        "1:50,2:20,4:20,8:10"
+
+/* Redis database of the consumer tables, kept apart from APPL_DB */
+#define BENCH_DB            15
+
+/* Entries popped by each run of the dispatch phase, under a key outside
+ * the benchmark routes */
+#define DISPATCH_ROUNDS     10000
+#define DISPATCH_KEY        "99.0.0.0/24"
+
+/* Fields of the pending port entry of the merge phase, the fields of each
+ * update and the updates merged into it */
+#define MERGE_FIELDS        32
+#define MERGE_UPDATE_FIELDS 4
+#define MERGE_ROUNDS        100000
+#define MERGE_KEY           "EthernetBench"
+
+struct BenchRoute
+{
+    string prefix;
+    string nexthop;
+    string ifindex;
+};
+
+static vector<Orch *> gOrchList;
+
+void usage(char **argv)
+{
+    cout << "Usage: " << argv[0] << " [-n ports] [-m neighbors] [-r routes]"
+         << " [-e width:weight[,...]] [-g groups] [-b batch] [-w budget] [-S seed] [-E]" << endl;
+    cout << "  -n  front panel ports (default " << DEFAULT_PORTS << ")" << endl;
+    cout << "  -m  neighbors, spread over the ports (default " << DEFAULT_NEIGHBORS << ")" << endl;
+    cout << "  -r  routes (default " << DEFAULT_ROUTES << ")" << endl;
+    cout << "  -e  ECMP width distribution (default " << DEFAULT_ECMP << ")" << endl;
+    cout << "  -g  distinct next hop sets per ECMP width (default " << DEFAULT_GROUPS << ")" << endl;
+    cout << "  -b  entries popped per consumer turn (default " << DEFAULT_BATCH_SIZE << ")" << endl;
+    cout << "  -w  entries synced per consumer turn (default " << DEFAULT_TASK_BUDGET << ")" << endl;
+    cout << "  -S  seed of the ECMP width and next hop choices" << endl;
+    cout << "  -E  emulate the bulk route calls with one call per route" << endl;
+}
+
+static string ipv4(uint32_t addr)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+             addr >> 24, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff);
+    return buf;
+}
+
+static string portAlias(uint32_t port)
+{
+    return "Ethernet" + to_string(port * 4);
+}
+
+/* Port p owns the subnet 10.<p / 256>.<p % 256>.0/24 */
+static uint32_t portSubnet(uint32_t port)
+{
+    return 0x0A000000 | (port << 8);
+}
+
+static long readStatus(const string &field)
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+            return atol(line.c_str() + field.size() + 1);
+    }
+    return 0;
+}
+
+static Consumer &getConsumer(Orch *orch, const string &table)
+{
+    for (Consumer *c : orch->getConsumers())
+    {
+        if (c->m_consumer->getTableName() == table)
+            return *c;
+    }
+    throw runtime_error("no consumer for table " + table);
+}
+
+/* Give every consumer with work left a turn until none has any */
+static void drain(size_t &peak, Consumer &watched)
+{
+    bool pending = true;
+    while (pending)
+    {
+        pending = false;
+        for (Orch *o : gOrchList)
+        {
+            if (!o->hasPendingTask())
+                continue;
+            pending = true;
+            peak = max(peak, watched.m_toSync.size());
+            o->doPendingTask();
+        }
+    }
+}
+
+/*
+ * Feed the entries gBatchSize at a time, giving the consumer one turn after
+ * every batch as OrchDaemon would after an execute, then drain the rest.
+ */
+static void feed(Orch *orch, Consumer &consumer, vector<KeyOpFieldsValuesTuple> &entries, size_t &peak)
+{
+    size_t i = 0;
+    while (i < entries.size())
+    {
+        for (int n = 0; n < gBatchSize && i < entries.size(); n++, i++)
+            orch->addTask(consumer, entries[i]);
+
+        peak = max(peak, consumer.m_toSync.size());
+        orch->doIncrementalTask(consumer);
+    }
+    drain(peak, consumer);
+}
+
+static void report(const char *phase, size_t routes, chrono::steady_clock::time_point start,
+                   size_t peak, Consumer &consumer)
+{
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%-9s %8zu routes %9.3f s %10.0f routes/s  peak m_toSync %7zu  parked %7zu"
+           "  sai routes %7u  rss %6ld kB  hwm %6ld kB\n",
+           phase, routes, secs, secs > 0 ? routes / secs : 0.0, peak,
+           consumer.m_toRetry.size(), saimock_get_count(SAIMOCK_LIMIT_ROUTES),
+           readStatus("VmRSS"), readStatus("VmHWM"));
+}
+
+/* Merge of a new entry into a pending one as Orch::addToSync did before
+ * SyncTask, kept for reference */
+static void legacyMerge(map<string, KeyOpFieldsValuesTuple> &toSync, KeyOpFieldsValuesTuple &new_data)
+{
+    string key = kfvKey(new_data);
+    string op  = kfvOp(new_data);
+
+    if (toSync.find(key) == toSync.end() || op == DEL_COMMAND)
+    {
+        toSync[key] = new_data;
+    }
+    else
+    {
+        KeyOpFieldsValuesTuple existing_data = toSync[key];
+
+        auto new_values = kfvFieldsValues(new_data);
+        auto existing_values = kfvFieldsValues(existing_data);
+
+        for (auto it : new_values)
+        {
+            string field = fvField(it);
+            string value = fvValue(it);
+
+            auto iu = existing_values.begin();
+            while (iu != existing_values.end())
+            {
+                string ofield = fvField(*iu);
+                if (field == ofield)
+                    iu = existing_values.erase(iu);
+                else
+                    iu++;
+            }
+            existing_values.push_back(FieldValueTuple(field, value));
+        }
+        toSync[key] = KeyOpFieldsValuesTuple(key, op, existing_values);
+    }
+}
+
+/*
+ * Time MERGE_ROUNDS updates of MERGE_UPDATE_FIELDS fields each into a
+ * pending port entry of MERGE_FIELDS fields, through Orch::addTask and
+ * through legacyMerge. The entry is left out of the port consumer after.
+ */
+static void merge(Orch *orch, Consumer &consumer)
+{
+    vector<FieldValueTuple> fvs = { FieldValueTuple("lanes", "0,1,2,3"),
+                                    FieldValueTuple("admin_status", "up"),
+                                    FieldValueTuple("speed", "100000"),
+                                    FieldValueTuple("mtu", "9100") };
+    for (int f = fvs.size(); f < MERGE_FIELDS; f++)
+        fvs.push_back(FieldValueTuple("attr_" + to_string(f), to_string(f)));
+
+    /* The updates go round the fields so that every one of them gets hit */
+    vector<KeyOpFieldsValuesTuple> updates;
+    for (int f = 0; f < MERGE_FIELDS; f += MERGE_UPDATE_FIELDS)
+    {
+        vector<FieldValueTuple> update;
+        for (int i = f; i < f + MERGE_UPDATE_FIELDS && i < MERGE_FIELDS; i++)
+            update.push_back(FieldValueTuple(fvField(fvs[i]), fvValue(fvs[i]) + "0"));
+        updates.push_back(KeyOpFieldsValuesTuple(MERGE_KEY, SET_COMMAND, update));
+    }
+
+    KeyOpFieldsValuesTuple entry(MERGE_KEY, SET_COMMAND, fvs);
+    auto start = chrono::steady_clock::now();
+    orch->addTask(consumer, entry);
+    for (int r = 0; r < MERGE_ROUNDS; r++)
+    {
+        /* addTask consumes the entry */
+        KeyOpFieldsValuesTuple update = updates[r % updates.size()];
+        orch->addTask(consumer, update);
+    }
+    double indexed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    consumer.m_toSync.erase(MERGE_KEY);
+
+    map<string, KeyOpFieldsValuesTuple> toSync;
+    entry = KeyOpFieldsValuesTuple(MERGE_KEY, SET_COMMAND, fvs);
+    start = chrono::steady_clock::now();
+    legacyMerge(toSync, entry);
+    for (int r = 0; r < MERGE_ROUNDS; r++)
+    {
+        KeyOpFieldsValuesTuple update = updates[r % updates.size()];
+        legacyMerge(toSync, update);
+    }
+    double legacy = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+
+    printf("merge     %d fields, %d per update  indexed %8.0f ns per update  copy-and-erase %8.0f ns per update\n",
+           MERGE_FIELDS, MERGE_UPDATE_FIELDS, indexed / MERGE_ROUNDS, legacy / MERGE_ROUNDS);
+}
+
+typedef unordered_map<Selectable *, pair<Orch *, Consumer *>> ConsumerIndex;
+
+/*
+ * Time OrchDaemon's dispatch of a ready consumer table: the lookup of its
+ * orch and consumer on its own, then Orch::execute popping the entry, which
+ * includes a round trip to redis. The entry is produced and taken out of
+ * m_toSync again outside of the timing.
+ */
+static void dispatch(const char *label, ConsumerIndex &index, ProducerTable &producer, Consumer &consumer)
+{
+    vector<FieldValueTuple> fvs = { FieldValueTuple("nexthop", "10.0.0.2"),
+                                    FieldValueTuple("ifindex", "Ethernet0") };
+
+    /* Too short to be timed one by one */
+    Consumer *volatile found = NULL;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < DISPATCH_ROUNDS; i++)
+        found = index.find(consumer.m_consumer)->second.second;
+    double lookup = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+
+    chrono::steady_clock::duration elapsed(0);
+    for (int i = 0; i < DISPATCH_ROUNDS; i++)
+    {
+        producer.set(DISPATCH_KEY, fvs);
+
+        auto it = index.find(consumer.m_consumer);
+        start = chrono::steady_clock::now();
+        it->second.first->execute(*it->second.second);
+        elapsed += chrono::steady_clock::now() - start;
+
+        consumer.m_toSync.erase(DISPATCH_KEY);
+    }
+
+    printf("dispatch  %-8s m_toSync %7zu  lookup %8.1f ns  execute %8.0f ns per dispatch\n", label,
+           found->m_toSync.size(), lookup / DISPATCH_ROUNDS,
+           chrono::duration<double, nano>(elapsed).count() / DISPATCH_ROUNDS);
+}
+
+static vector<KeyOpFieldsValuesTuple> routeEntries(const vector<BenchRoute> &routes, const string &op)
+{
+    vector<KeyOpFieldsValuesTuple> entries;
+    entries.reserve(routes.size());
+    for (auto &r : routes)
+    {
+        vector<FieldValueTuple> fvs;
+        if (op == SET_COMMAND)
+        {
+            fvs.push_back(FieldValueTuple("nexthop", r.nexthop));
+            fvs.push_back(FieldValueTuple("ifindex", r.ifindex));
+        }
+        entries.push_back(KeyOpFieldsValuesTuple(r.prefix, op, fvs));
+    }
+    return entries;
+}
+
+int main(int argc, char **argv)
+{
+    swss::Logger::getInstance().setMinPrio(swss::Logger::SWSS_WARN);
+
+    SWSS_LOG_ENTER();
+
+    int opt;
+    uint32_t ports = DEFAULT_PORTS;
+    uint32_t neighbors = DEFAULT_NEIGHBORS;
+    uint32_t route_count = DEFAULT_ROUTES;
+    uint32_t groups = DEFAULT_GROUPS;
+    string ecmp = DEFAULT_ECMP;
+    unsigned int seed = 1;
+    bool emulate_bulk = false;
+
+    while ((opt = getopt(argc, argv, "n:m:r:e:g:b:w:S:Eh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            ports = atoi(optarg);
+            break;
+        case 'm':
+            neighbors = atoi(optarg);
+            break;
+        case 'r':
+            route_count = atoi(optarg);
+            break;
+        case 'e':
+            ecmp = optarg;
+            break;
+        case 'g':
+            groups = atoi(optarg);
+            break;
+        case 'b':
+            gBatchSize = atoi(optarg);
+            break;
+        case 'w':
+            gTaskBudget = atoi(optarg);
+            break;
+        case 'S':
+            seed = atoi(optarg);
+            break;
+        case 'E':
+            emulate_bulk = true;
+            break;
+        case 'h':
+            usage(argv);
+            exit(EXIT_SUCCESS);
+        default: /* '?' */
+            usage(argv);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (ports == 0 || ports > 0xffff || neighbors == 0 || neighbors > ports * 253 ||
+        route_count > 0x100000 || groups == 0 || gBatchSize <= 0 || gTaskBudget <= 0)
+    {
+        cerr << "Invalid arguments: 1..65535 ports, up to 253 neighbors per port,"
+             << " up to 1048576 routes" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    /* ECMP width distribution: width:weight[,width:weight...] */
+    vector<pair<uint32_t, uint32_t>> widths;
+    uint32_t total_weight = 0;
+    stringstream ss(ecmp);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        size_t pos = item.find(':');
+        uint32_t width = atoi(item.substr(0, pos).c_str());
+        uint32_t weight = pos == string::npos ? 1 : atoi(item.substr(pos + 1).c_str());
+        if (width == 0 || width > neighbors)
+        {
+            cerr << "Invalid ECMP width " << item << endl;
+            exit(EXIT_FAILURE);
+        }
+        widths.push_back(make_pair(width, weight));
+        total_weight += weight;
+    }
+    if (total_weight == 0)
+    {
+        cerr << "Invalid ECMP distribution " << ecmp << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    /* Switch */
+    saimock_set_port_count(ports);
+    sai_api_initialize(0, NULL);
+    sai_api_query(SAI_API_SWITCH,               (void **)&sai_switch_api);
+    sai_api_query(SAI_API_VIRTUAL_ROUTER,       (void **)&sai_virtual_router_api);
+    sai_api_query(SAI_API_PORT,                 (void **)&sai_port_api);
+    sai_api_query(SAI_API_VLAN,                 (void **)&sai_vlan_api);
+    sai_api_query(SAI_API_HOST_INTERFACE,       (void **)&sai_hostif_api);
+    sai_api_query(SAI_API_ROUTER_INTERFACE,     (void **)&sai_router_intfs_api);
+    sai_api_query(SAI_API_NEIGHBOR,             (void **)&sai_neighbor_api);
+    sai_api_query(SAI_API_NEXT_HOP,             (void **)&sai_next_hop_api);
+    sai_api_query(SAI_API_NEXT_HOP_GROUP,       (void **)&sai_next_hop_group_api);
+    sai_api_query(SAI_API_ROUTE,                (void **)&sai_route_api);
+    sai_api_query(SAI_API_LAG,                  (void **)&sai_lag_api);
+    sai_route_bulk_api = emulate_bulk ? &emulated_route_bulk_api : saimock_route_bulk_api();
+
+    sai_switch_notification_t notifications = {};
+    if (sai_switch_api->initialize_switch(0, "", "", &notifications) != SAI_STATUS_SUCCESS)
+    {
+        cerr << "Failed to initialize switch" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    sai_attribute_t attr;
+    attr.id = SAI_SWITCH_ATTR_SRC_MAC_ADDRESS;
+    sai_switch_api->get_switch_attribute(1, &attr);
+    gMacAddress = attr.value.mac;
+    attr.id = SAI_SWITCH_ATTR_DEFAULT_VIRTUAL_ROUTER_ID;
+    sai_switch_api->get_switch_attribute(1, &attr);
+    gVirtualRouterId = attr.value.oid;
+
+    /* Orchs, wired as in OrchDaemon::init */
+    DBConnector *db = new DBConnector(BENCH_DB, "localhost", 6379, 0);
+    vector<string> ports_tables = { APP_PORT_TABLE_NAME, APP_VLAN_TABLE_NAME, APP_LAG_TABLE_NAME };
+    PortsOrch *ports_orch = new PortsOrch(db, ports_tables);
+    IntfsOrch *intfs_orch = new IntfsOrch(db, APP_INTF_TABLE_NAME, ports_orch);
+    NeighOrch *neigh_orch = new NeighOrch(db, APP_NEIGH_TABLE_NAME, ports_orch);
+    RouteOrch *route_orch = new RouteOrch(db, APP_ROUTE_TABLE_NAME, ports_orch, neigh_orch);
+    gOrchList = { ports_orch, intfs_orch, neigh_orch, route_orch };
+
+    ports_orch->attach(intfs_orch);
+    ports_orch->attach(neigh_orch);
+    ports_orch->attach(route_orch);
+    intfs_orch->attach(neigh_orch);
+    neigh_orch->attach(route_orch);
+
+    Consumer &port_consumer = getConsumer(ports_orch, APP_PORT_TABLE_NAME);
+    Consumer &intf_consumer = getConsumer(intfs_orch, APP_INTF_TABLE_NAME);
+    Consumer &neigh_consumer = getConsumer(neigh_orch, APP_NEIGH_TABLE_NAME);
+    Consumer &route_consumer = getConsumer(route_orch, APP_ROUTE_TABLE_NAME);
+
+    /* Ports, router interfaces and neighbors */
+    auto start = chrono::steady_clock::now();
+    size_t peak = 0;
+    vector<KeyOpFieldsValuesTuple> entries;
+    for (uint32_t p = 0; p < ports; p++)
+    {
+        string lanes;
+        for (uint32_t l = 0; l < 4; l++)
+            lanes += (l ? "," : "") + to_string(p * 4 + l);
+        vector<FieldValueTuple> fvs = { FieldValueTuple("lanes", lanes),
+                                        FieldValueTuple("admin_status", "up") };
+        entries.push_back(KeyOpFieldsValuesTuple(portAlias(p), SET_COMMAND, fvs));
+    }
+    entries.push_back(KeyOpFieldsValuesTuple("ConfigDone", SET_COMMAND, vector<FieldValueTuple>()));
+    feed(ports_orch, port_consumer, entries, peak);
+
+    entries.clear();
+    for (uint32_t p = 0; p < ports; p++)
+    {
+        string key = portAlias(p) + ":" + ipv4(portSubnet(p) | 1) + "/24";
+        entries.push_back(KeyOpFieldsValuesTuple(key, SET_COMMAND, vector<FieldValueTuple>()));
+    }
+    feed(intfs_orch, intf_consumer, entries, peak);
+
+    entries.clear();
+    vector<string> neighbor_ips, neighbor_aliases, neighbor_macs;
+    for (uint32_t n = 0; n < neighbors; n++)
+    {
+        uint32_t p = n % ports;
+        uint32_t addr = portSubnet(p) | (2 + n / ports);
+        char mac[18];
+        snprintf(mac, sizeof(mac), "00:00:0a:%02x:%02x:%02x",
+                 (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff);
+
+        neighbor_ips.push_back(ipv4(addr));
+        neighbor_aliases.push_back(portAlias(p));
+        neighbor_macs.push_back(mac);
+        vector<FieldValueTuple> fvs = { FieldValueTuple("neigh", mac) };
+        entries.push_back(KeyOpFieldsValuesTuple(portAlias(p) + ":" + ipv4(addr), SET_COMMAND, fvs));
+    }
+    feed(neigh_orch, neigh_consumer, entries, peak);
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("setup     %u ports, %u neighbors (%u synced, %zu parked) in %.3f s\n",
+           ports, neighbors, saimock_get_count(SAIMOCK_LIMIT_NEIGHBORS),
+           neigh_consumer.m_toRetry.size(), secs);
+
+    merge(ports_orch, port_consumer);
+
+    /*
+     * Routes: /24s from 100.0.0.0 on, each with an ECMP width drawn from the
+     * distribution and one of the groups sets of that many consecutive
+     * neighbors.
+     */
+    srand(seed);
+    vector<BenchRoute> routes(route_count);
+    for (uint32_t r = 0; r < route_count; r++)
+    {
+        uint32_t pick = rand() % total_weight;
+        uint32_t width = widths.back().first;
+        for (auto &w : widths)
+        {
+            if (pick < w.second)
+            {
+                width = w.first;
+                break;
+            }
+            pick -= w.second;
+        }
+
+        uint32_t first = (rand() % groups) * width;
+        BenchRoute &route = routes[r];
+        route.prefix = ipv4(0x64000000 + (r << 8)) + "/24";
+        for (uint32_t i = 0; i < width; i++)
+        {
+            uint32_t n = (first + i) % neighbors;
+            route.nexthop += (i ? "," : "") + neighbor_ips[n];
+            route.ifindex += (i ? "," : "") + neighbor_aliases[n];
+        }
+    }
+
+    vector<KeyOpFieldsValuesTuple> sets = routeEntries(routes, SET_COMMAND);
+    vector<KeyOpFieldsValuesTuple> dels = routeEntries(routes, DEL_COMMAND);
+
+    /* Dispatch, with no entry pending and with all the routes pending */
+    ConsumerIndex index;
+    for (Orch *o : gOrchList)
+    {
+        for (Consumer *c : o->getConsumers())
+            index[c->m_consumer] = make_pair(o, c);
+    }
+
+    ProducerTable route_producer(db, APP_ROUTE_TABLE_NAME);
+    dispatch("idle", index, route_producer, route_consumer);
+    entries = sets;
+    for (auto &e : entries)
+        route_orch->addTask(route_consumer, e);
+    dispatch("backlog", index, route_producer, route_consumer);
+    route_consumer.m_toSync.clear();
+
+    /* addTask consumes the entries, so every phase works on a copy */
+    entries = sets;
+    peak = 0;
+    start = chrono::steady_clock::now();
+    feed(route_orch, route_consumer, entries, peak);
+    report("add", route_count, start, peak, route_consumer);
+
+    entries = dels;
+    peak = 0;
+    start = chrono::steady_clock::now();
+    feed(route_orch, route_consumer, entries, peak);
+    report("withdraw", route_count, start, peak, route_consumer);
+
+    entries = sets;
+    peak = 0;
+    start = chrono::steady_clock::now();
+    feed(route_orch, route_consumer, entries, peak);
+    report("readd", route_count, start, peak, route_consumer);
+
+    /* Resync: a new generation, every route refreshed with its next hops, then the sweep */
+    peak = 0;
+    start = chrono::steady_clock::now();
+    entries = { KeyOpFieldsValuesTuple("resync", SET_COMMAND, vector<FieldValueTuple>()) };
+    feed(route_orch, route_consumer, entries, peak);
+    entries = sets;
+    feed(route_orch, route_consumer, entries, peak);
+    entries = { KeyOpFieldsValuesTuple("resync", DEL_COMMAND, vector<FieldValueTuple>()) };
+    feed(route_orch, route_consumer, entries, peak);
+    report("resync", route_count, start, peak, route_consumer);
+
+    /*
+     * Failover: the first neighbor goes away and comes back. Its ECMP groups
+     * are repaired in place; the routes using it alone keep it referenced,
+     * so the removal stays parked.
+     */
+    size_t affected = route_orch->getRouteCount(IpAddress(neighbor_ips[0]));
+    string neighbor_key = neighbor_aliases[0] + ":" + neighbor_ips[0];
+    vector<FieldValueTuple> neighbor_fvs = { FieldValueTuple("neigh", neighbor_macs[0]) };
+
+    peak = 0;
+    start = chrono::steady_clock::now();
+    entries = { KeyOpFieldsValuesTuple(neighbor_key, DEL_COMMAND, vector<FieldValueTuple>()) };
+    feed(neigh_orch, neigh_consumer, entries, peak);
+    report("failover", affected, start, peak, neigh_consumer);
+
+    peak = 0;
+    start = chrono::steady_clock::now();
+    entries = { KeyOpFieldsValuesTuple(neighbor_key, SET_COMMAND, neighbor_fvs) };
+    feed(neigh_orch, neigh_consumer, entries, peak);
+    report("restore", affected, start, peak, neigh_consumer);
+
+    return EXIT_SUCCESS;
+}
@@ -1,26 +1,78 @@
 #include "orchdaemon.h"
 
+#include "saiprofiler.h"
 #include "logger.h"
 
 #include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <system_error>
 
 using namespace std;
 using namespace swss;
 
+extern int gBatchSize;
+extern int gTaskTimeBudget;
+
 OrchDaemon::OrchDaemon()
 {
     m_applDb = nullptr;
     m_asicDb = nullptr;
+    m_countersDb = nullptr;
+    m_schedTable = nullptr;
+    m_retryTable = nullptr;
+    m_taskTable = nullptr;
+    m_convergenceTable = nullptr;
+    m_memoryTable = nullptr;
+    m_routeOrch = nullptr;
+    m_introspect = nullptr;
+    m_introspectPath = INTROSPECT_SOCKET;
+    m_saiProfileTable = nullptr;
+    m_starvationLimit = DEFAULT_STARVATION_LIMIT;
+
+    /* Link and neighbor changes are applied ahead of queued route churn */
+    m_tablePriority = {
+        { APP_PORT_TABLE_NAME,  PRIORITY_PORT },
+        { APP_VLAN_TABLE_NAME,  PRIORITY_PORT },
+        { APP_LAG_TABLE_NAME,   PRIORITY_PORT },
+        { APP_INTF_TABLE_NAME,  PRIORITY_INTF },
+        { APP_NEIGH_TABLE_NAME, PRIORITY_NEIGH },
+        { APP_ROUTE_TABLE_NAME, PRIORITY_ROUTE }
+    };
 }
 
 OrchDaemon::~OrchDaemon()
 {
+    if (m_introspect)
+        delete(m_introspect);
+
     if (m_applDb)
         delete(m_applDb);
 
     if (m_asicDb)
         delete(m_asicDb);
 
+    if (m_schedTable)
+        delete(m_schedTable);
+
+    if (m_retryTable)
+        delete(m_retryTable);
+
+    if (m_taskTable)
+        delete(m_taskTable);
+
+    if (m_convergenceTable)
+        delete(m_convergenceTable);
+
+    if (m_memoryTable)
+        delete(m_memoryTable);
+
+    if (m_saiProfileTable)
+        delete(m_saiProfileTable);
+
+    if (m_countersDb)
+        delete(m_countersDb);
+
     for (Orch *o : m_orchList)
         delete(o);
 }
@@ -30,6 +82,14 @@ bool OrchDaemon::init()
     SWSS_LOG_ENTER();
 
     m_applDb = new DBConnector(APPL_DB, "localhost", 6379, 0);
+    m_countersDb = new DBConnector(COUNTERS_DB, "localhost", 6379, 0);
+    m_schedTable = new Table(m_countersDb, SCHED_COUNTERS_TABLE);
+    m_retryTable = new Table(m_countersDb, RETRY_COUNTERS_TABLE);
+    m_taskTable = new Table(m_countersDb, TASK_COUNTERS_TABLE);
+    m_convergenceTable = new Table(m_countersDb, CONVERGENCE_COUNTERS_TABLE);
+    m_memoryTable = new Table(m_countersDb, MEMORY_COUNTERS_TABLE);
+    if (SaiProfiler::isEnabled())
+        m_saiProfileTable = new Table(m_countersDb, SAI_PROFILE_TABLE);
 
     vector<string> ports_tables = {
         APP_PORT_TABLE_NAME,
@@ -42,60 +102,497 @@ bool OrchDaemon::init()
     NeighOrch *neigh_orch = new NeighOrch(m_applDb, APP_NEIGH_TABLE_NAME, ports_orch);
     RouteOrch *route_orch = new RouteOrch(m_applDb, APP_ROUTE_TABLE_NAME, ports_orch, neigh_orch);
 
+    /* Re-queue parked tasks as soon as the objects they depend on are created */
+    ports_orch->attach(intfs_orch);
+    ports_orch->attach(neigh_orch);
+    ports_orch->attach(route_orch);
+    intfs_orch->attach(neigh_orch);
+    neigh_orch->attach(route_orch);
+
     m_orchList = { ports_orch, intfs_orch, neigh_orch, route_orch };
-    m_select = new Select();
+    m_routeOrch = route_orch;
+    for (Orch *o : m_orchList)
+        o->setRetryWheel(&m_retryWheel);
+
+    m_select = new EpollSelect();
 
     return true;
 }
 
-void OrchDaemon::start()
+bool OrchDaemon::hasPendingTask()
+{
+    for (Orch *o : m_orchList)
+    {
+        if (o->hasPendingTask())
+            return true;
+    }
+    return false;
+}
+
+void OrchDaemon::setTablePriority(string table, int priority)
 {
     SWSS_LOG_ENTER();
 
+    SWSS_LOG_NOTICE("Set priority of table %s to %d\n", table.c_str(), priority);
+    m_tablePriority[table] = priority;
+}
+
+void OrchDaemon::setStarvationLimit(int limit)
+{
+    m_starvationLimit = limit;
+}
+
+void OrchDaemon::setIntrospectPath(const string &path)
+{
+    m_introspectPath = path;
+}
+
+void OrchDaemon::schedule()
+{
+    /*
+     * Only the consumers at the most urgent priority with pending work get a
+     * turn. A lower priority consumer passed over m_starvationLimit times
+     * runs anyway, so that routes still make progress while ports flap.
+     */
+    int level = -1;
+    for (SchedEntry &e : m_schedule)
+    {
+        if (!e.consumer->hasWork())
+        {
+            e.skipped = 0;
+            continue;
+        }
+
+        if (level == -1)
+            level = e.priority;
+
+        if (e.priority == level || e.skipped >= m_starvationLimit)
+        {
+            e.orch->doIncrementalTask(*e.consumer);
+            e.skipped = 0;
+        }
+        else
+        {
+            e.skipped++;
+        }
+    }
+}
+
+void OrchDaemon::expireRetryTimers()
+{
+    auto now = m_retryWheel.now();
+    vector<RetryTimer> due;
+
+    m_retryWheel.expire(now, due);
+    for (auto &t : due)
+        t.orch->retryDueTask(*t.consumer, t.key, now);
+}
+
+static void addHistogram(vector<FieldValueTuple> &fvs, const string &name,
+                         const LatencyHistogram &histogram)
+{
+    fvs.push_back(FieldValueTuple(name + "_p50", to_string(histogram.getPercentile(50))));
+    fvs.push_back(FieldValueTuple(name + "_p99", to_string(histogram.getPercentile(99))));
+    fvs.push_back(FieldValueTuple(name + "_max", to_string(histogram.getMax())));
+}
+
+void OrchDaemon::updateCounters()
+{
+    auto now = chrono::steady_clock::now();
+    if (chrono::duration_cast<chrono::milliseconds>(now - m_lastCountersUpdate).count() < COUNTERS_INTERVAL)
+        return;
+    m_lastCountersUpdate = now;
+
+    /* PRIORITY_<n>: tables at this priority, entries pending and parked */
+    auto it = m_schedule.begin();
+    while (it != m_schedule.end())
+    {
+        int priority = it->priority;
+        string tables;
+        size_t pending = 0, parked = 0;
+
+        for (; it != m_schedule.end() && it->priority == priority; it++)
+        {
+            if (!tables.empty())
+                tables += ",";
+            tables += it->consumer->m_consumer->getTableName();
+            pending += it->consumer->m_toSync.size();
+            parked += it->consumer->m_toRetry.size();
+        }
+
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("tables", tables));
+        fvs.push_back(FieldValueTuple("pending", to_string(pending)));
+        fvs.push_back(FieldValueTuple("parked", to_string(parked)));
+        m_schedTable->set("PRIORITY_" + to_string(priority), fvs);
+    }
+
+    /* <table>: entries in backoff, the most attempts and the count per reason */
+    for (SchedEntry &e : m_schedule)
+    {
+        Consumer &c = *e.consumer;
+        int max_attempts = c.m_parkedAttempts.empty() ? 0 : c.m_parkedAttempts.rbegin()->first;
+
+        /* Reasons that no longer apply are overwritten with 0 rather than
+         * deleted, so that readers never see the key vanish */
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("in_backoff", to_string(c.m_toRetry.size())));
+        fvs.push_back(FieldValueTuple("max_attempts", to_string(max_attempts)));
+        for (auto &r : c.m_parkedReasons)
+            fvs.push_back(FieldValueTuple("reason:" + r.first, to_string(r.second)));
+        m_retryTable->set(c.m_tableName, fvs);
+    }
+
+    /* <table>: task counters since start and lifecycle percentiles over the last window */
+    uint64_t sec = TaskStats::getSec(now);
+    for (SchedEntry &e : m_schedule)
+    {
+        const TaskStats &stats = e.consumer->m_stats;
+        vector<FieldValueTuple> fvs;
+
+        fvs.push_back(FieldValueTuple("pops", to_string(stats.pops)));
+        fvs.push_back(FieldValueTuple("merges", to_string(stats.merges)));
+        fvs.push_back(FieldValueTuple("drops", to_string(stats.drops)));
+        fvs.push_back(FieldValueTuple("failures", to_string(stats.failures)));
+        fvs.push_back(FieldValueTuple("window_sec", to_string(stats.queueWait.getWindowSec())));
+        addHistogram(fvs, "queue_wait_ns", stats.queueWait.get(sec));
+        addHistogram(fvs, "retries", stats.retries.get(sec));
+        addHistogram(fvs, "programmed_ns", stats.programmed.get(sec));
+        m_taskTable->set(e.consumer->m_consumer->getTableName(), fvs);
+    }
+
+    /* ROUTE_TABLE: FPM to SAI latency of the routes stamped by fpmsyncd -t */
+    if (m_routeOrch)
+    {
+        LatencyHistogram convergence = m_routeOrch->getConvergence();
+        vector<FieldValueTuple> fvs;
+
+        fvs.push_back(FieldValueTuple("window_sec", to_string(m_routeOrch->getConvergenceWindowSec())));
+        fvs.push_back(FieldValueTuple("routes", to_string(convergence.getCount())));
+        fvs.push_back(FieldValueTuple("slow_routes", to_string(m_routeOrch->getSlowRouteCount())));
+        addHistogram(fvs, "fpm_to_sai_ns", convergence);
+        m_convergenceTable->set(APP_ROUTE_TABLE_NAME, fvs);
+    }
+
+    /* <table>: live bytes and allocations of an orch table or of a consumer's maps */
+    for (auto &m : getMemoryStats())
+        m_memoryTable->set(m.first, m.second);
+
+    if (m_saiProfileTable)
+        SaiProfiler::publish(*m_saiProfileTable);
+}
+
+vector<pair<string, vector<FieldValueTuple>>> OrchDaemon::getMemoryStats()
+{
+    vector<pair<string, vector<FieldValueTuple>>> result;
+
     for (Orch *o : m_orchList)
     {
-        m_select->addSelectables(o->getSelectables());
+        vector<pair<string, const AllocStats *>> stats;
+        o->getMemoryStats(stats);
+
+        for (auto &s : stats)
+        {
+            vector<FieldValueTuple> fvs;
+            fvs.push_back(FieldValueTuple("bytes", to_string(s.second->bytes)));
+            /* One allocation per node for maps, per buffer for vectors */
+            fvs.push_back(FieldValueTuple("allocations", to_string(s.second->blocks)));
+            fvs.push_back(FieldValueTuple("peak_bytes", to_string(s.second->peakBytes)));
+            fvs.push_back(FieldValueTuple("bytes_per_allocation", to_string(
+                    s.second->blocks ? s.second->bytes / s.second->blocks : 0)));
+            result.push_back(make_pair(s.first, fvs));
+        }
+    }
+
+    return result;
+}
+
+string OrchDaemon::dumpState()
+{
+    SWSS_LOG_ENTER();
+
+    string out;
+    auto now = chrono::steady_clock::now();
+
+    for (Orch *o : m_orchList)
+    {
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("type", "orch"));
+        o->dumpState(fvs);
+        out += toJson(fvs) + "\n";
+    }
+
+    for (SchedEntry &e : m_schedule)
+    {
+        Consumer &c = *e.consumer;
+        chrono::steady_clock::duration oldest_pending(0), oldest_parked(0);
+
+        for (auto &t : c.m_toSync)
+        {
+            if (t.second.m_popTime != chrono::steady_clock::time_point())
+                oldest_pending = max(oldest_pending, now - t.second.m_popTime);
+        }
+        for (auto &t : c.m_toRetry)
+        {
+            if (t.second.m_popTime != chrono::steady_clock::time_point())
+                oldest_parked = max(oldest_parked, now - t.second.m_popTime);
+        }
+
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("type", "consumer"));
+        fvs.push_back(FieldValueTuple("table", c.m_consumer->getTableName()));
+        fvs.push_back(FieldValueTuple("priority", to_string(e.priority)));
+        fvs.push_back(FieldValueTuple("skipped", to_string(e.skipped)));
+        fvs.push_back(FieldValueTuple("pending", to_string(c.m_toSync.size())));
+        fvs.push_back(FieldValueTuple("oldest_pending_ms", to_string(
+                chrono::duration_cast<chrono::milliseconds>(oldest_pending).count())));
+        fvs.push_back(FieldValueTuple("parked", to_string(c.m_toRetry.size())));
+        fvs.push_back(FieldValueTuple("oldest_parked_ms", to_string(
+                chrono::duration_cast<chrono::milliseconds>(oldest_parked).count())));
+        fvs.push_back(FieldValueTuple("pops", to_string(c.m_stats.pops)));
+        fvs.push_back(FieldValueTuple("failures", to_string(c.m_stats.failures)));
+        out += toJson(fvs) + "\n";
+    }
+
+    for (auto &m : getMemoryStats())
+    {
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("type", "memory"));
+        fvs.push_back(FieldValueTuple("name", m.first));
+        fvs.insert(fvs.end(), m.second.begin(), m.second.end());
+        out += toJson(fvs) + "\n";
+    }
+
+    vector<FieldValueTuple> fvs;
+    fvs.push_back(FieldValueTuple("type", "daemon"));
+    fvs.push_back(FieldValueTuple("retry_timers", to_string(m_retryWheel.size())));
+    fvs.push_back(FieldValueTuple("recording", TaskRecorder::isEnabled() ? "true" : "false"));
+    fvs.push_back(FieldValueTuple("sai_profile", SaiProfiler::isEnabled() ? "true" : "false"));
+    out += toJson(fvs) + "\n";
+
+    return out;
+}
+
+void OrchDaemon::buildSchedule()
+{
+    m_schedule.clear();
+    for (Orch *o : m_orchList)
+    {
+        for (Consumer *c : o->getConsumers())
+        {
+            int priority = PRIORITY_DEFAULT;
+            auto it = m_tablePriority.find(c->m_consumer->getTableName());
+            if (it != m_tablePriority.end())
+                priority = it->second;
+            m_schedule.push_back({ o, c, priority, 0 });
+        }
+    }
+
+    /* Within a priority, keep the m_orchList order */
+    stable_sort(m_schedule.begin(), m_schedule.end(),
+                [](const SchedEntry &a, const SchedEntry &b) { return a.priority < b.priority; });
+}
+
+void OrchDaemon::start()
+{
+    SWSS_LOG_ENTER();
+
+    buildSchedule();
+    for (SchedEntry &e : m_schedule)
+    {
+        m_consumerIndex[e.consumer->m_consumer] = make_pair(e.orch, e.consumer);
+        m_select->addSelectable(e.consumer->m_consumer);
+    }
+
+    if (!m_introspectPath.empty())
+    {
+        try
+        {
+            m_introspect = new IntrospectServer(m_introspectPath, [this]() { return dumpState(); });
+            m_select->addSelectable(m_introspect);
+            SWSS_LOG_NOTICE("Serving introspection on %s\n", m_introspectPath.c_str());
+        }
+        catch (system_error &e)
+        {
+            SWSS_LOG_WARN("Failed to create introspection socket %s: %s\n",
+                          m_introspectPath.c_str(), e.what());
+        }
     }
 
     while (true)
     {
-        Selectable *s;
-        int fd, ret;
+        vector<Selectable *> ready;
+        int ret;
 
-        ret = m_select->select(&s, &fd, 1);
-        if (ret == Select::ERROR)
+        updateCounters();
+        SaiProfiler::handleDumpRequest();
+
+        /* Only poll for new events while some consumer has work left over,
+         * otherwise wake up for the next armed retry timer */
+        bool pending = hasPendingTask();
+        int timeout = pending ? 0 : m_retryWheel.getTimeout(chrono::steady_clock::now(), SELECT_TIMEOUT);
+
+        ret = m_select->select(ready, timeout);
+        if (ret == EpollSelect::ERROR)
         {
             SWSS_LOG_NOTICE("Error: %s!\n", strerror(errno));
             continue;
         }
 
-        if (ret == Select::TIMEOUT)
+        for (Selectable *s : ready)
         {
-            /* After every TIMEOUT, periodically check all m_toSync map to
-             * execute all the remaining tasks that need to be retried. */
-            for (Orch *o : m_orchList)
-                o->doTask();
+            /* Introspection clients are served from its readMe() */
+            if (s == m_introspect)
+                continue;
 
-            continue;
+            auto it = m_consumerIndex.find(s);
+            if (it == m_consumerIndex.end())
+            {
+                SWSS_LOG_ERROR("Failed to get Orch class by selectable\n");
+                continue;
+            }
+            it->second.first->execute(*it->second.second);
         }
+        TaskRecorder::flush();
 
-        Orch *o = getOrchByConsumer((ConsumerTable *)s);
-        o->execute(((ConsumerTable *)s)->getTableName());
+        expireRetryTimers();
+
+        /* Give the most urgent consumers one turn within their work budget,
+         * so that a bulk route load cannot hold off port and neighbor
+         * updates, then poll for new events again. */
+        schedule();
     }
 }
 
-Orch *OrchDaemon::getOrchByConsumer(ConsumerTable *c)
+bool OrchDaemon::replay(const string &path, bool realtime)
 {
     SWSS_LOG_ENTER();
 
-    for (Orch *o : m_orchList)
+    TaskRecordReader reader;
+    if (!reader.open(path))
+        return false;
+
+    buildSchedule();
+
+    map<string, SchedEntry *> tables;
+    for (SchedEntry &e : m_schedule)
+        tables[e.consumer->m_consumer->getTableName()] = &e;
+
+    /*
+     * Entries of one table recorded back to back are handed over up to
+     * gBatchSize at a time, as execute() would after a select, and the
+     * consumers get their turns in between. The scheduler also runs while
+     * waiting for the next entry to be due. As fast as possible, the retry
+     * timers run on the recorded timeline instead of the clock and no time
+     * budget applies, so that every replay of a file programs the same
+     * entries in the same order.
+     */
+    TaskRecord record;
+    uint64_t count = 0;
+    uint64_t skipped = 0;
+    uint64_t base = 0;
+    int batch = 0;
+    string batchTable;
+    int timeBudget = gTaskTimeBudget;
+    auto start = chrono::steady_clock::now();
+    auto segmentStart = start;
+
+    if (!realtime)
+    {
+        m_retryWheel.setTimeline(start);
+        gTaskTimeBudget = 0;
+    }
+
+    while (reader.next(record))
+    {
+        /* The time between two orchagent runs is not replayed */
+        if (record.newSegment)
+        {
+            base = record.time;
+            segmentStart = m_retryWheel.now();
+        }
+        auto due = segmentStart + chrono::nanoseconds(record.time - base);
+
+        if (batch && (record.table != batchTable || batch >= gBatchSize ||
+                      due > m_retryWheel.now()))
+        {
+            expireRetryTimers();
+            schedule();
+            batch = 0;
+        }
+
+        while (true)
+        {
+            auto now = m_retryWheel.now();
+            if (now >= due)
+                break;
+
+            if (hasPendingTask())
+            {
+                expireRetryTimers();
+                schedule();
+                continue;
+            }
+
+            auto timeout = min(chrono::duration_cast<chrono::steady_clock::duration>(
+                    chrono::milliseconds(m_retryWheel.getTimeout(now, SELECT_TIMEOUT))), due - now);
+            if (realtime)
+                this_thread::sleep_for(timeout);
+            else
+                m_retryWheel.setTime(now + timeout);
+            expireRetryTimers();
+        }
+
+        auto it = tables.find(record.table);
+        if (it == tables.end())
+        {
+            skipped++;
+            continue;
+        }
+
+        it->second->orch->addTask(*it->second->consumer, record.entry);
+        batchTable = record.table;
+        batch++;
+        count++;
+
+        updateCounters();
+    }
+
+    while (hasPendingTask())
     {
-        if (o->hasSelectable(c))
-            return o;
+        expireRetryTimers();
+        schedule();
     }
 
-    SWSS_LOG_ERROR("Failed to get Orch class by ConsumerTable:%s",
-            c->getTableName().c_str());
+    if (!realtime)
+    {
+        /* Let every parked task run out its backoff once more */
+        m_retryWheel.setTime(m_retryWheel.now() + chrono::milliseconds(RETRY_BACKOFF_MAX));
+        do
+        {
+            expireRetryTimers();
+            schedule();
+        }
+        while (hasPendingTask());
+
+        gTaskTimeBudget = timeBudget;
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    SWSS_LOG_NOTICE("Replayed %llu tasks from %s in %.3f s, %llu of unknown tables skipped\n",
+                    (unsigned long long)count, path.c_str(), secs, (unsigned long long)skipped);
 
-    return nullptr;
+    for (SchedEntry &e : m_schedule)
+    {
+        if (!e.consumer->m_toRetry.empty())
+            SWSS_LOG_NOTICE("%zu tasks of %s left parked\n", e.consumer->m_toRetry.size(),
+                            e.consumer->m_consumer->getTableName().c_str());
+    }
+
+    m_lastCountersUpdate = chrono::steady_clock::time_point();
+    updateCounters();
+    if (SaiProfiler::isEnabled())
+        SaiProfiler::dump();
+
+    return true;
 }
@@ -4,15 +4,49 @@
 #include "dbconnector.h"
 #include "producertable.h"
 #include "consumertable.h"
-#include "select.h"
+#include "table.h"
+#include "common/epollselect.h"
 
 #include "portsorch.h"
 #include "intfsorch.h"
 #include "neighorch.h"
 #include "routeorch.h"
+#include "retrywheel.h"
+#include "taskrecorder.h"
+#include "introspect.h"
+
+#include <unordered_map>
+#include <chrono>
 
 using namespace swss;
 
+/* Maximum time to wait for an event (ms) */
+#define SELECT_TIMEOUT 1000
+
+/* Scheduling priority of a consumer table, 0 being the most urgent */
+#define PRIORITY_PORT       0
+#define PRIORITY_INTF       1
+#define PRIORITY_NEIGH      2
+#define PRIORITY_ROUTE      3
+#define PRIORITY_DEFAULT    PRIORITY_ROUTE
+/* Turns a consumer with pending work may be passed over before it runs */
+#define DEFAULT_STARVATION_LIMIT 8
+/* Interval of the scheduler and retry counters update in COUNTERS_DB (ms) */
+#define COUNTERS_INTERVAL 1000
+#define SCHED_COUNTERS_TABLE "ORCH_SCHED"
+#define RETRY_COUNTERS_TABLE "ORCH_RETRY"
+#define TASK_COUNTERS_TABLE "ORCH_TASK"
+#define CONVERGENCE_COUNTERS_TABLE "ORCH_CONVERGENCE"
+#define MEMORY_COUNTERS_TABLE "ORCH_MEMORY"
+
+struct SchedEntry
+{
+    Orch               *orch;
+    Consumer           *consumer;
+    int                 priority;
+    int                 skipped;    // turns passed over while pending
+};
+
 class OrchDaemon
 {
 public:
@@ -21,15 +55,60 @@ public:
 
     bool init();
     void start();
+    /* Feed the tasks recorded in path to the orchs instead of the consumer
+     * tables, at the recorded pace or as fast as possible on the recorded
+     * timeline */
+    bool replay(const string &path, bool realtime);
+
+    /* Override the scheduling priority of a consumer table */
+    void setTablePriority(string table, int priority);
+    void setStarvationLimit(int limit);
+    /* Unix socket serving dumpState(), none if empty */
+    void setIntrospectPath(const string &path);
 private:
     DBConnector *m_applDb;
     DBConnector *m_asicDb;
+    DBConnector *m_countersDb;
 
     std::vector<Orch *> m_orchList;
+    RouteOrch *m_routeOrch;
+
+    EpollSelect *m_select;
+
+    string m_introspectPath;
+    IntrospectServer *m_introspect;
+
+    /* Selectable to the Orch and Consumer that handle it, built in start() */
+    unordered_map<Selectable *, pair<Orch *, Consumer *>> m_consumerIndex;
+
+    map<string, int> m_tablePriority;
+    int m_starvationLimit;
+    /* Consumers sorted by priority, built in start() */
+    vector<SchedEntry> m_schedule;
+
+    /* Parked tasks waiting for their backoff to elapse */
+    RetryWheel m_retryWheel;
 
-    Select *m_select;
+    Table *m_schedTable;
+    Table *m_retryTable;
+    Table *m_taskTable;
+    Table *m_convergenceTable;
+    Table *m_memoryTable;
+    Table *m_saiProfileTable;
+    chrono::steady_clock::time_point m_lastCountersUpdate;
 
-    Orch *getOrchByConsumer(ConsumerTable *c);
+    bool hasPendingTask();
+    /* Sort the consumers of all orchs into m_schedule */
+    void buildSchedule();
+    /* Give the consumers of the most urgent pending priority one turn each */
+    void schedule();
+    /* Move the parked tasks whose backoff has elapsed back to m_toSync */
+    void expireRetryTimers();
+    void updateCounters();
+    /* JSON lines: one per orch, one per consumer and one for the daemon */
+    string dumpState();
+    /* Fields of the live memory of every orch table and consumer, by name */
+    vector<pair<string, vector<FieldValueTuple>>> getMemoryStats();
 };
 
 #endif /* SWSS_ORCHDAEMON_H */
@@ -0,0 +1,194 @@
+#include "traceevents.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace swss;
+
+struct EventInfo
+{
+    const char *name;
+    const char *args;
+};
+
+#define ORCH_TRACE_INFO(id, name, args) { name, args },
+static const EventInfo events[] =
+{
+    { "none", "" },
+    ORCH_TRACE_EVENTS(ORCH_TRACE_INFO)
+};
+#undef ORCH_TRACE_INFO
+
+void usage(char **argv)
+{
+    cout << "Usage: " << argv[0] << " [-n records] [file]" << endl;
+    cout << "  Decode the trace ring of orchagent (default " << TRACE_RING_PATH << ")" << endl;
+    cout << "  -n  only the last records" << endl;
+}
+
+static string formatTime(uint64_t ns)
+{
+    time_t sec = ns / 1000000000;
+    struct tm tm;
+    char buf[64];
+
+    localtime_r(&sec, &tm);
+    size_t len = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(buf + len, sizeof(buf) - len, ".%09llu", (unsigned long long)(ns % 1000000000));
+    return buf;
+}
+
+static string formatArg(const string &type, uint64_t value)
+{
+    char buf[INET_ADDRSTRLEN + 32];
+
+    if (type == "ip4")
+    {
+        struct in_addr addr;
+        addr.s_addr = (uint32_t)value;
+        inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+    }
+    else if (type == "oid")
+        snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)value);
+    else if (type == "status")
+        snprintf(buf, sizeof(buf), "%d", (int)(int32_t)value);
+    else
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+    return buf;
+}
+
+static void printRecord(const TraceRecord &r)
+{
+    cout << formatTime(r.time) << " ";
+
+    if (r.event >= TRACE_EVENT_MAX)
+    {
+        cout << "event_" << r.event;
+        for (int i = 0; i < TRACE_RING_MAX_ARGS; i++)
+            cout << " " << formatArg("oid", r.args[i]);
+        cout << endl;
+        return;
+    }
+
+    cout << events[r.event].name;
+
+    istringstream args(events[r.event].args);
+    string arg;
+    for (int i = 0; i < TRACE_RING_MAX_ARGS && args >> arg; i++)
+    {
+        size_t colon = arg.find(':');
+        cout << " " << arg.substr(0, colon) << "="
+             << formatArg(arg.substr(colon + 1), r.args[i]);
+    }
+    cout << endl;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    uint64_t last = 0;
+    string path = TRACE_RING_PATH;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            last = strtoull(optarg, NULL, 10);
+            break;
+        case 'h':
+            usage(argv);
+            exit(EXIT_SUCCESS);
+        default: /* '?' */
+            usage(argv);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (optind < argc)
+        path = argv[optind];
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        cerr << "Failed to open " << path << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    /* Map the ring rather than read it, so that each record can be checked
+     * again once copied */
+    void *addr = MAP_FAILED;
+    if ((size_t)st.st_size >= sizeof(TraceRingHeader))
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    const TraceRingHeader *header = (const TraceRingHeader *)addr;
+    if (addr == MAP_FAILED ||
+        memcmp(header->magic, TRACE_RING_MAGIC, TRACE_RING_MAGIC_SIZE) ||
+        header->recordSize != sizeof(TraceRecord) || header->capacity == 0)
+    {
+        cerr << path << " is not a trace ring" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if ((size_t)st.st_size < sizeof(TraceRingHeader) + (size_t)header->capacity * sizeof(TraceRecord))
+    {
+        cerr << path << " is truncated" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const TraceRecord *records = (const TraceRecord *)(header + 1);
+    uint64_t capacity = header->capacity;
+
+    uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    if (last && head - first > last)
+        first = head - last;
+
+    /*
+     * The ring may still be written to. A record is kept only if its
+     * sequence number matches its position both before and after it is
+     * copied; otherwise it was being written, or a newer lap overwrote it
+     * while it was copied.
+     */
+    uint64_t skipped = 0;
+    for (uint64_t index = first; index < head; index++)
+    {
+        const TraceRecord *slot = &records[index & (capacity - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != index + 1)
+        {
+            skipped++;
+            continue;
+        }
+
+        TraceRecord r;
+        memcpy(&r, slot, sizeof(r));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != index + 1)
+        {
+            skipped++;
+            continue;
+        }
+        printRecord(r);
+    }
+
+    if (skipped)
+        cerr << skipped << " records skipped while being written" << endl;
+
+    return EXIT_SUCCESS;
+}
@@ -19,7 +19,8 @@ extern sai_hostif_api_t* sai_hostif_api;
 #define DEFAULT_VLAN_ID     1
 
 PortsOrch::PortsOrch(DBConnector *db, vector<string> tableNames) :
-        Orch(db, tableNames)
+        Orch(db, tableNames),
+        m_portList(CountingMap<string, Port>::allocator_type(&m_portListMemory))
 {
     SWSS_LOG_ENTER();
 
@@ -166,6 +167,19 @@ bool PortsOrch::isInitDone()
     return m_initDone;
 }
 
+void PortsOrch::dumpState(vector<FieldValueTuple> &fvs)
+{
+    fvs.push_back(FieldValueTuple("orch", "PortsOrch"));
+    fvs.push_back(FieldValueTuple("ports", to_string(m_portList.size())));
+    fvs.push_back(FieldValueTuple("init_done", m_initDone ? "true" : "false"));
+}
+
+void PortsOrch::getMemoryStats(vector<pair<string, const AllocStats *>> &stats)
+{
+    Orch::getMemoryStats(stats);
+    stats.push_back(make_pair("PortList", &m_portListMemory));
+}
+
 bool PortsOrch::getPort(string alias, Port &p)
 {
     if (m_portList.find(alias) == m_portList.end())
@@ -223,10 +237,15 @@ void PortsOrch::doPortTask(Consumer &consumer)
             {
                 m_initDone = true;
                 SWSS_LOG_INFO("Get ConfigDone notification from portsyncd.\n");
+
+                /* Retry the tasks parked while waiting for port initialization */
+                for (auto &i : m_consumerMap)
+                    retryAllTasks(i.second);
+                notify(SUBJECT_TYPE_PORT_CONFIG_DONE, NULL);
             }
 
-            it = consumer.m_toSync.erase(it);
-            return;
+            it = completeTask(consumer, it);
+            continue;
         }
 
         if (op == "SET")
@@ -298,6 +317,7 @@ void PortsOrch::doPortTask(Consumer &consumer)
                     else
                     {
                         SWSS_LOG_ERROR("Failed to set port to admin %s alias:%s\n", admin_status.c_str(), alias.c_str());
+                        it->second.m_reason = "set admin status failed";
                         it++;
                         continue;
                     }
@@ -309,7 +329,7 @@ void PortsOrch::doPortTask(Consumer &consumer)
         else
             SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
 
-        it = consumer.m_toSync.erase(it);
+        it = completeTask(consumer, it);
     }
 }
 
@@ -352,14 +372,17 @@ void PortsOrch::doVlanTask(Consumer &consumer)
                 if (m_portList.find(vlan_alias) != m_portList.end())
                 {
                     SWSS_LOG_ERROR("Duplicate VLAN entry alias:%s", vlan_alias.c_str());
-                    it = consumer.m_toSync.erase(it);
+                    it = dropTask(consumer, it);
                     continue;
                 }
 
                 if (addVlan(vlan_alias))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "add VLAN failed";
                     it++;
+                }
             }
             else if (op == DEL_COMMAND)
             {
@@ -367,14 +390,17 @@ void PortsOrch::doVlanTask(Consumer &consumer)
                 assert(getPort(vlan_alias, vlan));
 
                 if (removeVlan(vlan))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "remove VLAN failed";
                     it++;
+                }
             }
             else
             {
                 SWSS_LOG_ERROR("Unknown operation type %s", op.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
             }
         }
         /* Manipulate member */
@@ -392,7 +418,7 @@ void PortsOrch::doVlanTask(Consumer &consumer)
                 {
                     SWSS_LOG_ERROR("Duplicate VLAN member entry vlan:%s port:%s",
                             vlan_alias.c_str(), port_alias.c_str());
-                    it = consumer.m_toSync.erase(it);
+                    it = dropTask(consumer, it);
                     continue;
                 }
 
@@ -400,9 +426,12 @@ void PortsOrch::doVlanTask(Consumer &consumer)
                 assert(!port.m_vlan_id && !port.m_vlan_member_id);
 
                 if (addVlanMember(vlan, port))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "add VLAN member failed";
                     it++;
+                }
             }
             else if (op == DEL_COMMAND)
             {
@@ -412,14 +441,17 @@ void PortsOrch::doVlanTask(Consumer &consumer)
                 assert(port.m_vlan_id && port.m_vlan_member_id);
 
                 if (removeVlanMember(vlan, port))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "remove VLAN member failed";
                     it++;
+                }
             }
             else
             {
                 SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
             }
         }
     }
@@ -457,14 +489,17 @@ void PortsOrch::doLagTask(Consumer &consumer)
                 if (m_portList.find(lag_alias) != m_portList.end())
                 {
                     SWSS_LOG_ERROR("Duplicate LAG entry alias:%s", lag_alias.c_str());
-                    it = consumer.m_toSync.erase(it);
+                    it = dropTask(consumer, it);
                     continue;
                 }
 
                 if (addLag(lag_alias))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "add LAG failed";
                     it++;
+                }
             }
             else if (op == DEL_COMMAND)
             {
@@ -472,14 +507,17 @@ void PortsOrch::doLagTask(Consumer &consumer)
                 assert(getPort(lag_alias, lag));
 
                 if (removeLag(lag))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "remove LAG failed";
                     it++;
+                }
             }
             else
             {
                 SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
             }
         }
         /* Manipulate member */
@@ -497,7 +535,7 @@ void PortsOrch::doLagTask(Consumer &consumer)
                 {
                     SWSS_LOG_ERROR("Duplicate LAG member entry lag:%s port:%s",
                             lag_alias.c_str(), port_alias.c_str());
-                    it = consumer.m_toSync.erase(it);
+                    it = dropTask(consumer, it);
                     continue;
                 }
 
@@ -505,9 +543,12 @@ void PortsOrch::doLagTask(Consumer &consumer)
                 assert(!port.m_lag_id && !port.m_lag_member_id);
 
                 if (addLagMember(lag, port))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "add LAG member failed";
                     it++;
+                }
             }
             else if (op == DEL_COMMAND)
             {
@@ -517,14 +558,17 @@ void PortsOrch::doLagTask(Consumer &consumer)
                 assert(port.m_lag_id && port.m_lag_member_id);
 
                 if (removeLagMember(lag, port))
-                    it = consumer.m_toSync.erase(it);
+                    it = completeTask(consumer, it);
                 else
+                {
+                    it->second.m_reason = "remove LAG member failed";
                     it++;
+                }
             }
             else
             {
                 SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
             }
         }
     }
@@ -2,13 +2,14 @@
 #define SWSS_PORTSORCH_H
 
 #include "orch.h"
+#include "observer.h"
 #include "port.h"
 
 #include "macaddress.h"
 
 #include <map>
 
-class PortsOrch : public Orch
+class PortsOrch : public Orch, public Subject
 {
 public:
     PortsOrch(DBConnector *db, vector<string> tableNames);
@@ -18,13 +19,17 @@ public:
     bool getPort(string alias, Port &port);
     void setPort(string alias, Port port);
 
+    void dumpState(vector<FieldValueTuple> &fvs);
+    void getMemoryStats(vector<pair<string, const AllocStats *>> &stats);
+
 private:
     bool m_initDone = false;
     sai_object_id_t m_cpuPort;
 
     sai_uint32_t m_portCount;
     map<set<int>, sai_object_id_t> m_portListLaneMap;
-    map<string, Port> m_portList;
+    AllocStats m_portListMemory;
+    CountingMap<string, Port> m_portList;
 
     void doTask(Consumer &consumer);
     void doPortTask(Consumer &consumer);
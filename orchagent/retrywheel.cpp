@@ -0,0 +1,125 @@
+#include "retrywheel.h"
+
+#include <algorithm>
+
+using namespace std;
+
+RetryWheel::RetryWheel() :
+    m_start(chrono::steady_clock::now()),
+    m_tick(0),
+    m_next(0),
+    m_size(0),
+    m_slots(RETRY_WHEEL_SLOTS),
+    m_timeline(false)
+{
+}
+
+chrono::steady_clock::time_point RetryWheel::now() const
+{
+    return m_timeline ? m_time : chrono::steady_clock::now();
+}
+
+void RetryWheel::setTimeline(chrono::steady_clock::time_point start)
+{
+    /* Ticks count from start so that they do not depend on the host either */
+    m_start = start;
+    m_tick = 0;
+    m_next = 0;
+    m_timeline = true;
+    m_time = start;
+}
+
+void RetryWheel::setTime(chrono::steady_clock::time_point time)
+{
+    m_time = time;
+}
+
+int64_t RetryWheel::getElapsed(chrono::steady_clock::time_point when) const
+{
+    return chrono::duration_cast<chrono::milliseconds>(when - m_start).count();
+}
+
+void RetryWheel::schedule(Orch *orch, Consumer *consumer, const string &key,
+                          chrono::steady_clock::time_point when)
+{
+    /* Round up so that the timer never fires before when */
+    int64_t elapsed = chrono::duration_cast<chrono::microseconds>(when - m_start).count();
+    int64_t tick_us = RETRY_WHEEL_TICK * 1000;
+    uint64_t tick = max<int64_t>((elapsed + tick_us - 1) / tick_us, 0);
+    tick = max<uint64_t>(tick, m_tick);
+
+    m_slots[tick % RETRY_WHEEL_SLOTS].push_back({ orch, consumer, key, tick });
+    if (m_size == 0 || tick < m_next)
+        m_next = tick;
+    m_size++;
+}
+
+void RetryWheel::expire(chrono::steady_clock::time_point now, vector<RetryTimer> &due)
+{
+    int64_t elapsed = getElapsed(now);
+    if (elapsed < 0 || m_size == 0)
+    {
+        m_tick = max<uint64_t>(m_tick, max<int64_t>(elapsed, 0) / RETRY_WHEEL_TICK);
+        return;
+    }
+
+    uint64_t now_tick = elapsed / RETRY_WHEEL_TICK;
+    if (now_tick < m_tick)
+        return;
+
+    /* After a long stall every slot is visited once */
+    uint64_t last = min<uint64_t>(now_tick, m_tick + RETRY_WHEEL_SLOTS - 1);
+    for (uint64_t t = m_tick; t <= last; t++)
+    {
+        auto &slot = m_slots[t % RETRY_WHEEL_SLOTS];
+        auto it = slot.begin();
+        while (it != slot.end())
+        {
+            if (it->tick <= now_tick)
+            {
+                due.push_back(move(*it));
+                it = slot.erase(it);
+                m_size--;
+            }
+            else
+                it++;
+        }
+    }
+
+    m_tick = now_tick + 1;
+    if (m_size && m_next < m_tick)
+        m_next = findNext();
+}
+
+uint64_t RetryWheel::findNext() const
+{
+    /* A timer due at tick t sits in the slot of t, the first match is the earliest */
+    for (uint64_t t = m_tick; t < m_tick + RETRY_WHEEL_SLOTS; t++)
+    {
+        for (auto &timer : m_slots[t % RETRY_WHEEL_SLOTS])
+        {
+            if (timer.tick == t)
+                return t;
+        }
+    }
+
+    /* Every timer is more than a turn away */
+    uint64_t next = UINT64_MAX;
+    for (auto &slot : m_slots)
+    {
+        for (auto &timer : slot)
+            next = min(next, timer.tick);
+    }
+    return next;
+}
+
+int RetryWheel::getTimeout(chrono::steady_clock::time_point now, int max) const
+{
+    if (m_size == 0)
+        return max;
+
+    int64_t timeout = (int64_t)std::max(m_next, m_tick) * RETRY_WHEEL_TICK - getElapsed(now);
+    if (timeout < 0)
+        return 0;
+    return (int)min<int64_t>(timeout, max);
+}
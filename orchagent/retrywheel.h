@@ -0,0 +1,66 @@
+#ifndef SWSS_RETRYWHEEL_H
+#define SWSS_RETRYWHEEL_H
+
+#include "orch.h"
+
+#include <chrono>
+#include <list>
+#include <vector>
+
+/* Resolution of the retry timers (ms) */
+#define RETRY_WHEEL_TICK    100
+/* Number of slots, one wheel turn covers RETRY_BACKOFF_MAX */
+#define RETRY_WHEEL_SLOTS   512
+
+struct RetryTimer
+{
+    Orch               *orch;
+    Consumer           *consumer;
+    string              key;        // parked task key
+    uint64_t            tick;       // tick at which the timer fires
+};
+
+/*
+ * Hashed timer wheel of the parked tasks waiting for their backoff to
+ * elapse. Timers are never cancelled: a task that was retried or updated in
+ * the meantime is simply skipped by Orch::retryDueTask when its timer fires.
+ */
+class RetryWheel
+{
+public:
+    RetryWheel();
+
+    void schedule(Orch *orch, Consumer *consumer, const string &key,
+                  chrono::steady_clock::time_point when);
+    /* Move every timer due by now into due */
+    void expire(chrono::steady_clock::time_point now, vector<RetryTimer> &due);
+    /* Milliseconds until the earliest armed timer fires, at most max */
+    int getTimeout(chrono::steady_clock::time_point now, int max) const;
+    size_t size() const { return m_size; }
+
+    /* Time of the timers: steady_clock, or the replayed timeline if any */
+    chrono::steady_clock::time_point now() const;
+    /*
+     * Run the timers on a replayed timeline from start on, which setTime
+     * then advances. Only valid while no timer is armed.
+     */
+    void setTimeline(chrono::steady_clock::time_point start);
+    void setTime(chrono::steady_clock::time_point time);
+
+private:
+    chrono::steady_clock::time_point m_start;
+    /* Next tick to be expired */
+    uint64_t m_tick;
+    /* Earliest tick of the armed timers, when m_size is not 0 */
+    uint64_t m_next;
+    size_t m_size;
+    vector<list<RetryTimer>> m_slots;
+    /* Replayed time, when m_timeline is set */
+    bool m_timeline;
+    chrono::steady_clock::time_point m_time;
+
+    int64_t getElapsed(chrono::steady_clock::time_point when) const;
+    uint64_t findNext() const;
+};
+
+#endif /* SWSS_RETRYWHEEL_H */
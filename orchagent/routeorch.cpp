@@ -1,17 +1,82 @@
 #include "routeorch.h"
 
 #include "logger.h"
+#include "common/probes.h"
+#include "traceevents.h"
 
 #include "assert.h"
 
+#include <chrono>
+
 extern sai_next_hop_group_api_t*    sai_next_hop_group_api;
 extern sai_route_api_t*             sai_route_api;
+extern sai_route_bulk_api_t*        sai_route_bulk_api;
 
 extern sai_object_id_t gVirtualRouterId;
 
-bool RouteOrch::hasNextHopGroup(IpAddresses ipAddresses)
+bool RouteOrch::hasNextHopGroup(const IpAddresses &ipAddresses) const
 {
-    return m_syncdNextHopGroups.find(ipAddresses) != m_syncdNextHopGroups.end();
+    NextHopSetId id = m_nextHopSets.find(ipAddresses);
+    return id != NEXT_HOP_SET_NONE && m_nextHopSets.get(id).next_hop_group_id;
+}
+
+void RouteOrch::update(SubjectType type, void *cntx)
+{
+    Consumer &consumer = m_consumerMap.at(APP_ROUTE_TABLE_NAME);
+
+    switch (type)
+    {
+        case SUBJECT_TYPE_NEXTHOP_CHANGE:
+        {
+            NextHopUpdate *update = static_cast<NextHopUpdate *>(cntx);
+            restoreNextHop(update->ip_address);
+
+            auto it = m_pendingNextHops.find(update->ip_address);
+            if (it == m_pendingNextHops.end())
+                break;
+
+            for (auto &key : it->second)
+                retryTask(consumer, key);
+            m_pendingNextHops.erase(it);
+            break;
+        }
+        case SUBJECT_TYPE_NEXTHOP_LOSS:
+        {
+            NextHopUpdate *update = static_cast<NextHopUpdate *>(cntx);
+            pruneNextHop(update->ip_address);
+            break;
+        }
+        case SUBJECT_TYPE_PORT_CONFIG_DONE:
+            retryAllTasks(consumer);
+            break;
+        default:
+            break;
+    }
+}
+
+RouteTaskCache &RouteOrch::getTaskCache(SyncTask &task)
+{
+    if (!task.m_cache)
+    {
+        auto cache = make_shared<RouteTaskCache>();
+        const KeyOpFieldsValuesTuple &t = task.m_kfv;
+
+        cache->ip_prefix = IpPrefix(kfvKey(t));
+        for (auto &i : kfvFieldsValues(t))
+        {
+            if (fvField(i) == "nexthop")
+                cache->ip_addresses = IpAddresses(fvValue(i));
+
+            if (fvField(i) == "ifindex")
+                cache->alias = fvValue(i);
+
+            if (fvField(i) == "timestamp")
+                cache->timestamp = strtoull(fvValue(i).c_str(), NULL, 10);
+        }
+        task.m_cache = cache;
+    }
+
+    return *static_pointer_cast<RouteTaskCache>(task.m_cache);
 }
 
 void RouteOrch::doTask(Consumer& consumer)
@@ -21,80 +86,87 @@ void RouteOrch::doTask(Consumer& consumer)
     if (!m_portsOrch->isInitDone())
         return;
 
+    /* The sweep takes whatever is left of the turn, once per turn */
+    if (m_sweeping && consumer.m_budget > 0)
+        sweepRoutes(consumer);
+
     auto it = consumer.m_toSync.begin();
     while (it != consumer.m_toSync.end())
     {
-        KeyOpFieldsValuesTuple t = it->second;
+        const KeyOpFieldsValuesTuple &t = it->second.m_kfv;
 
         string key = kfvKey(t);
         string op = kfvOp(t);
 
         /* Get notification from application */
         /* resync application:
-         * When routeorch receives 'resync' message, it marks all current
-         * routes as dirty and waits for 'resync complete' message. For all
-         * newly received routes, if they match current dirty routes, it unmarks
-         * them dirty. After receiving 'resync complete' message, it creates all
-         * newly added routes and removes all dirty routes.
+         * When routeorch receives 'resync' message, it starts a new
+         * generation. Routes received from then on are applied as usual and
+         * stamped with it, unchanged ones without any SAI call. After
+         * receiving 'resync complete' message, the routes still stamped with
+         * an older generation were not refreshed and are swept away, one
+         * slice per turn.
          */
         if (key == "resync")
         {
+            /* The queued routes must not see their tasks replaced */
+            flushRoutes(consumer);
+
             if (op == "SET")
             {
-                /* Mark all current routes as dirty (DEL) in consumer.m_toSync map */
-                SWSS_LOG_NOTICE("Start resync routes\n");
-                for (auto i : m_syncdRoutes)
-                {
-                    vector<FieldValueTuple> v;
-                    auto x = KeyOpFieldsValuesTuple(i.first.to_string(), DEL_COMMAND, v);
-                    consumer.m_toSync[i.first.to_string()] = x;
-                }
+                SWSS_LOG_NOTICE("Start resync routes, generation %u\n", m_generation + 1);
+                m_generation++;
                 m_resync = true;
+
+                /* A sweep still running is taken over by the new one */
+                m_sweeping = false;
+                consumer.m_workPending = false;
             }
             else
             {
-                SWSS_LOG_NOTICE("Complete resync routes\n");
+                SWSS_LOG_NOTICE("Complete resync routes, generation %u\n", m_generation);
                 m_resync = false;
+
+                /* The sweep starts with the next doTask call */
+                if (!m_syncdRoutes.empty())
+                {
+                    m_sweeping = true;
+                    m_sweepCursor = m_syncdRoutes.begin()->first;
+                    consumer.m_workPending = true;
+                }
             }
 
-            it = consumer.m_toSync.erase(it);
+            it = completeTask(consumer, it);
             continue;
         }
 
-        if (m_resync)
-        {
-            it++;
-            continue;
-        }
+        /* Whatever becomes of the task now, it no longer waits as parked */
+        if (!m_pendingKeys.empty())
+            clearPendingNextHops(key);
+        if (!m_pendingGroups.empty())
+            m_pendingGroups.erase(key);
 
-        IpPrefix ip_prefix = IpPrefix(key);
+        /* Parse the key and fields once, retries reuse the decoded task */
+        RouteTaskCache &cache = getTaskCache(it->second);
+        const IpPrefix &ip_prefix = cache.ip_prefix;
 
         /* Currently we don't support IPv6 */
         if (!ip_prefix.isV4())
         {
             SWSS_LOG_WARN("Get unsupported IPv6 task ip:%s", ip_prefix.to_string().c_str());
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
             continue;
         }
 
         if (op == SET_COMMAND)
         {
-            IpAddresses ip_addresses;
-            string alias;
-
-            for (auto i : kfvFieldsValues(t))
-            {
-                if (fvField(i) == "nexthop")
-                    ip_addresses = IpAddresses(fvValue(i));
-
-                if (fvField(i) == "ifindex")
-                    alias = fvValue(i);
-            }
+            const IpAddresses &ip_addresses = cache.ip_addresses;
+            const string &alias = cache.alias;
 
             // TODO: set to blackhold if nexthop is empty?
             if (ip_addresses.getSize() == 0)
             {
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
                 continue;
             }
 
@@ -102,98 +174,445 @@ void RouteOrch::doTask(Consumer& consumer)
             // TODO: need to split aliases with ',' and verify the next hops?
             if (alias == "eth0" || alias == "lo" || alias == "docker0")
             {
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
                 continue;
             }
 
-            if (m_syncdRoutes.find(ip_prefix) == m_syncdRoutes.end() || m_syncdRoutes[ip_prefix] != ip_addresses)
+            auto it_route = m_syncdRoutes.find(ip_prefix);
+            if (it_route == m_syncdRoutes.end() || it_route->second.next_hops != m_nextHopSets.find(ip_addresses))
             {
-                if (addRoute(ip_prefix, ip_addresses))
-                    it = consumer.m_toSync.erase(it);
-                else
-                    it++;
+                /* Step past the task first, flushing erases the queued ones */
+                auto task = it++;
+                RouteBulkOp bulk_op = it_route == m_syncdRoutes.end() ? ROUTE_BULK_CREATE : ROUTE_BULK_SET;
+                if (!queueRoute(consumer, task, bulk_op))
+                {
+                    /* Retry as soon as the missing or lost next hops are (re)created */
+                    task->second.m_reason = "add route failed";
+                    for (auto &ip : ip_addresses.getIpAddresses())
+                    {
+                        if (!m_neighOrch->hasNextHop(ip) || m_neighOrch->isNextHopLost(ip))
+                        {
+                            m_pendingNextHops[ip].insert(key);
+                            m_pendingKeys[key].push_back(ip);
+                            task->second.m_reason = "next hop unresolved";
+                        }
+                    }
+
+                    /* Or as soon as a next hop group is removed */
+                    if (ip_addresses.getSize() > 1 && isNextHopGroupTableFull())
+                    {
+                        m_pendingGroups.insert(key);
+                        if (m_pendingKeys.find(key) == m_pendingKeys.end())
+                            task->second.m_reason = "next hop group table full";
+                    }
+                }
             }
             else
-                /* Duplicate entry */
-                it = consumer.m_toSync.erase(it);
+            {
+                /* Duplicate entry, refreshed for the resync */
+                it_route->second.generation = m_generation;
+                it = dropTask(consumer, it);
+            }
         }
         else if (op == DEL_COMMAND)
         {
             if (m_syncdRoutes.find(ip_prefix) != m_syncdRoutes.end())
             {
-                if (removeRoute(ip_prefix))
-                    it = consumer.m_toSync.erase(it);
-                else
-                    it++;
+                auto task = it++;
+                queueRoute(consumer, task, ROUTE_BULK_REMOVE);
             }
             else
                 /* Cannot locate the route */
-                it = consumer.m_toSync.erase(it);
+                it = dropTask(consumer, it);
         }
         else
         {
             SWSS_LOG_ERROR("Unknown operation type %s\n", op.c_str());
-            it = consumer.m_toSync.erase(it);
+            it = dropTask(consumer, it);
         }
     }
+
+    flushRoutes(consumer);
 }
 
-void RouteOrch::increaseNextHopRefCount(IpAddresses ipAddresses)
+void RouteOrch::clearPendingNextHops(const string &key)
 {
+    auto it = m_pendingKeys.find(key);
+    if (it == m_pendingKeys.end())
+        return;
 
-    if (ipAddresses.getSize() == 1)
+    /* A next hop whose creation retried the key already dropped it */
+    for (auto &ip : it->second)
     {
-        IpAddress ip_address(ipAddresses.to_string());
-        m_neighOrch->increaseNextHopRefCount(ip_address);
+        auto pending = m_pendingNextHops.find(ip);
+        if (pending == m_pendingNextHops.end())
+            continue;
+
+        pending->second.erase(key);
+        if (pending->second.empty())
+            m_pendingNextHops.erase(pending);
     }
-    else
+
+    m_pendingKeys.erase(it);
+}
+
+void RouteOrch::sweepRoutes(Consumer &consumer)
+{
+    SWSS_LOG_ENTER();
+
+    /*
+     * Stale routes are removed through DEL tasks, so that the removals go
+     * through the bulk calls like any other. A route with a task of its own
+     * pending, parked or still in the backlog of doIncrementalTask is left
+     * to that task.
+     */
+    int budget = consumer.m_budget;
+    consumer.m_budget = 0;
+
+    auto it_route = m_syncdRoutes.lower_bound(m_sweepCursor);
+    for (int i = 0; i < ROUTE_RESYNC_SWEEP_SLICE && budget > 0 && it_route != m_syncdRoutes.end(); i++, it_route++)
     {
-        m_syncdNextHopGroups[ipAddresses].ref_count ++;
+        if (it_route->second.generation == m_generation)
+            continue;
+
+        string key = it_route->first.to_string();
+        if (consumer.m_toSync.find(key) != consumer.m_toSync.end() ||
+            consumer.m_toRetry.find(key) != consumer.m_toRetry.end() ||
+            consumer.m_backlog.find(key) != consumer.m_backlog.end())
+            continue;
+
+        consumer.m_toSync.emplace(key, KeyOpFieldsValuesTuple(key, DEL_COMMAND, vector<FieldValueTuple>()));
+        budget--;
+    }
+
+    if (it_route != m_syncdRoutes.end())
+    {
+        m_sweepCursor = it_route->first;
+        return;
     }
+
+    SWSS_LOG_NOTICE("Swept routes of generation %u\n", m_generation);
+    m_sweeping = false;
+    consumer.m_workPending = false;
 }
-void RouteOrch::decreaseNextHopRefCount(IpAddresses ipAddresses)
+
+bool RouteOrch::queueRoute(Consumer &consumer, SyncMap::iterator task, RouteBulkOp op)
 {
-    if (ipAddresses.getSize() == 1)
+    RouteBulkEntry entry;
+    entry.task = task;
+
+    if (op != ROUTE_BULK_REMOVE)
     {
-        IpAddress ip_address(ipAddresses.to_string());
-        m_neighOrch->decreaseNextHopRefCount(ip_address);
+        RouteTaskCache &cache = getTaskCache(task->second);
+
+        /* The routes queued before may free a next hop group, as they would
+         * have in order: program them before a group is needed from a full
+         * table */
+        if (m_bulkSize && isNextHopGroupTableFull() && cache.ip_addresses.getSize() > 1)
+        {
+            NextHopSetId id = m_nextHopSets.find(cache.ip_addresses);
+            if (id == NEXT_HOP_SET_NONE || !m_nextHopSets.get(id).next_hop_group_id)
+                flushRoutes(consumer);
+        }
+
+        entry.next_hops = m_nextHopSets.intern(cache.ip_addresses);
+        if (!resolveNextHops(cache.ip_prefix, entry.next_hops, entry.next_hop_id))
+        {
+            m_nextHopSets.collect(entry.next_hops);
+            return false;
+        }
+
+        /* Keep the next hop (group) alive until the route is programmed */
+        increaseNextHopRefCount(entry.next_hops);
+    }
+
+    m_bulkRoutes[op].push_back(entry);
+    if (++m_bulkSize >= ROUTE_BULK_MAX_SIZE)
+        flushRoutes(consumer);
+
+    return true;
+}
+
+void RouteOrch::flushRoutes(Consumer &consumer)
+{
+    SWSS_LOG_ENTER();
+
+    vector<sai_unicast_route_entry_t> route_entries;
+    vector<sai_attribute_t> route_attrs;
+    vector<uint32_t> attr_counts;
+    vector<const sai_attribute_t *> attr_lists;
+    vector<sai_status_t> statuses;
+
+    /* Removals first, so that they make room for the creations */
+    for (int op = 0; op < ROUTE_BULK_OP_MAX; op++)
+    {
+        vector<RouteBulkEntry> &entries = m_bulkRoutes[op];
+        uint32_t count = (uint32_t)entries.size();
+        if (!count)
+            continue;
+
+        route_entries.resize(count);
+        route_attrs.resize(count);
+        statuses.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const IpPrefix &ip_prefix = getTaskCache(entries[i].task->second).ip_prefix;
+
+            route_entries[i].vr_id = gVirtualRouterId;
+            route_entries[i].destination.addr_family = SAI_IP_ADDR_FAMILY_IPV4;
+            route_entries[i].destination.addr.ip4 = ip_prefix.getIp().getV4Addr();
+            route_entries[i].destination.mask.ip4 = ip_prefix.getMask().getV4Addr();
+
+            route_attrs[i].id = SAI_ROUTE_ATTR_NEXT_HOP_ID;
+            route_attrs[i].value.oid = entries[i].next_hop_id;
+        }
+
+        sai_status_t status;
+        SWSS_PROBE2(route_bulk_entry, op, count);
+        switch (op)
+        {
+            case ROUTE_BULK_REMOVE:
+                status = sai_route_bulk_api->remove_routes(count, route_entries.data(), statuses.data());
+                break;
+            case ROUTE_BULK_SET:
+                status = sai_route_bulk_api->set_routes_attribute(count, route_entries.data(),
+                                                                  route_attrs.data(), statuses.data());
+                break;
+            default:
+                attr_counts.assign(count, 1);
+                attr_lists.resize(count);
+                for (uint32_t i = 0; i < count; i++)
+                    attr_lists[i] = &route_attrs[i];
+                status = sai_route_bulk_api->create_routes(count, route_entries.data(), attr_counts.data(),
+                                                           attr_lists.data(), statuses.data());
+                break;
+        }
+        SWSS_PROBE3(route_bulk_return, op, count, status);
+        if (status != SAI_STATUS_SUCCESS)
+            SWSS_LOG_INFO("Bulk route operation %d on %u routes returned %d\n", op, count, status);
+
+        for (uint32_t i = 0; i < count; i++)
+            completeRoute(consumer, (RouteBulkOp)op, entries[i], route_entries[i], statuses[i]);
+        entries.clear();
+    }
+
+    m_bulkSize = 0;
+}
+
+void RouteOrch::completeRoute(Consumer &consumer, RouteBulkOp op, RouteBulkEntry &entry,
+                              const sai_unicast_route_entry_t &route_entry, sai_status_t status)
+{
+    SyncTask &task = entry.task->second;
+    RouteTaskCache &cache = getTaskCache(task);
+
+    if (op == ROUTE_BULK_REMOVE)
+    {
+        TraceRing::record(TRACE_ROUTE_REMOVE, route_entry.destination.addr.ip4,
+                          route_entry.destination.mask.ip4, status);
+        if (status != SAI_STATUS_SUCCESS)
+        {
+            SWSS_LOG_ERROR("Failed to remove route prefix:%s\n", cache.ip_prefix.to_string().c_str());
+            task.m_reason = "remove route failed";
+            return;
+        }
+
+        auto it_route = m_syncdRoutes.find(cache.ip_prefix);
+        NextHopSetId old_next_hops = it_route->second.next_hops;
+        m_syncdRoutes.erase(it_route);
+        releaseNextHops(old_next_hops);
+        completeTask(consumer, entry.task);
+        return;
+    }
+
+    TraceRing::record(op == ROUTE_BULK_CREATE ? TRACE_ROUTE_CREATE : TRACE_ROUTE_SET,
+                      route_entry.destination.addr.ip4, route_entry.destination.mask.ip4,
+                      entry.next_hop_id, status);
+    if (status != SAI_STATUS_SUCCESS)
+    {
+        SWSS_LOG_ERROR("Failed to %s route %s with next hop(s) %s",
+                       op == ROUTE_BULK_CREATE ? "create" : "set",
+                       cache.ip_prefix.to_string().c_str(), cache.ip_addresses.to_string().c_str());
+        releaseNextHops(entry.next_hops);
+        task.m_reason = "add route failed";
+        return;
+    }
+
+    /* The route no longer uses its previous next hop (group) */
+    NextHopSetId old_next_hops = setSyncdRoute(cache.ip_prefix, entry.next_hops);
+    if (old_next_hops != NEXT_HOP_SET_NONE)
+        releaseNextHops(old_next_hops);
+
+    recordConvergence(task, cache);
+    completeTask(consumer, entry.task);
+}
+
+void RouteOrch::recordConvergence(const SyncTask &task, const RouteTaskCache &cache)
+{
+    if (!cache.timestamp)
+        return;
+
+    auto steady_now = chrono::steady_clock::now();
+    uint64_t now = chrono::duration_cast<chrono::microseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+
+    /* fpmsyncd runs on the same host, a clock step is the only way back */
+    if (now < cache.timestamp)
+        return;
+
+    uint64_t latency = now - cache.timestamp;
+    m_convergence.add(now / 1000000, latency * 1000);
+
+    if (latency < CONVERGENCE_SLOW_THRESHOLD)
+        return;
+
+    if (m_slowRoutes++ % CONVERGENCE_TRACE_SAMPLE)
+        return;
+
+    /* Split the latency at the time orchagent popped the update whose
+     * timestamp the route carries, the latest one merged */
+    uint64_t orch = 0;
+    if (task.m_updateTime != chrono::steady_clock::time_point())
+        orch = min(latency, (uint64_t)chrono::duration_cast<chrono::microseconds>(
+                steady_now - task.m_updateTime).count());
+
+    SWSS_LOG_NOTICE("Slow route %s: %llu us from FPM to SAI, %llu us before orchagent,"
+                    " %llu us in orchagent, %d retries, next hop(s) %s\n",
+                    cache.ip_prefix.to_string().c_str(), (unsigned long long)latency,
+                    (unsigned long long)(latency - orch), (unsigned long long)orch,
+                    task.m_attempts, cache.ip_addresses.to_string().c_str());
+}
+
+void RouteOrch::dumpState(vector<FieldValueTuple> &fvs)
+{
+    fvs.push_back(FieldValueTuple("orch", "RouteOrch"));
+    fvs.push_back(FieldValueTuple("routes", to_string(m_syncdRoutes.size())));
+    fvs.push_back(FieldValueTuple("next_hop_sets", to_string(m_nextHopSets.size())));
+    fvs.push_back(FieldValueTuple("next_hop_group_count", to_string(m_nextHopGroupCount)));
+    fvs.push_back(FieldValueTuple("pruned_next_hops", to_string(m_prunedMembers)));
+    fvs.push_back(FieldValueTuple("pending_next_hops", to_string(m_pendingNextHops.size())));
+    fvs.push_back(FieldValueTuple("pending_routes", to_string(m_pendingKeys.size())));
+    fvs.push_back(FieldValueTuple("pending_group_routes", to_string(m_pendingGroups.size())));
+    fvs.push_back(FieldValueTuple("resync", m_resync ? "true" : "false"));
+    fvs.push_back(FieldValueTuple("resync_generation", to_string(m_generation)));
+    fvs.push_back(FieldValueTuple("resync_sweep", m_sweeping ? "true" : "false"));
+}
+
+void RouteOrch::getMemoryStats(vector<pair<string, const AllocStats *>> &stats)
+{
+    Orch::getMemoryStats(stats);
+    stats.push_back(make_pair("RouteTable", &m_routeMemory));
+    stats.push_back(make_pair("NextHopSets", m_nextHopSets.getMemoryStats()));
+}
+
+LatencyHistogram RouteOrch::getConvergence() const
+{
+    return m_convergence.get(chrono::duration_cast<chrono::seconds>(
+            chrono::system_clock::now().time_since_epoch()).count());
+}
+
+NextHopSetId RouteOrch::setSyncdRoute(const IpPrefix &ipPrefix, NextHopSetId nextHops)
+{
+    NextHopSetId old_next_hops = NEXT_HOP_SET_NONE;
+
+    auto it_route = m_syncdRoutes.find(ipPrefix);
+    if (it_route == m_syncdRoutes.end())
+    {
+        m_syncdRoutes.emplace(ipPrefix, RouteEntry(nextHops, m_generation));
     }
     else
     {
-        m_syncdNextHopGroups[ipAddresses].ref_count --;
+        old_next_hops = it_route->second.next_hops;
+        it_route->second.next_hops = nextHops;
+        it_route->second.generation = m_generation;
+    }
+
+    return old_next_hops;
+}
+
+size_t RouteOrch::getRouteCount(const IpAddress &ipAddress) const
+{
+    /* Each route holds a reference on its next hop set */
+    size_t routes = 0;
+    for (NextHopSetId id : m_nextHopSets.getSetsByNextHop(ipAddress))
+        routes += m_nextHopSets.get(id).ref_count;
+    return routes;
+}
+
+void RouteOrch::increaseNextHopRefCount(NextHopSetId id)
+{
+    NextHopSet &next_hops = m_nextHopSets.get(id);
+
+    next_hops.ref_count ++;
+    if (next_hops.ip_addresses.getSize() == 1)
+    {
+        IpAddress ip_address(next_hops.ip_addresses.to_string());
+        m_neighOrch->increaseNextHopRefCount(ip_address);
+    }
+}
+
+void RouteOrch::decreaseNextHopRefCount(NextHopSetId id)
+{
+    NextHopSet &next_hops = m_nextHopSets.get(id);
+
+    next_hops.ref_count --;
+    if (next_hops.ip_addresses.getSize() == 1)
+    {
+        IpAddress ip_address(next_hops.ip_addresses.to_string());
+        m_neighOrch->decreaseNextHopRefCount(ip_address);
     }
 }
 
-bool RouteOrch::addNextHopGroup(IpAddresses ipAddresses)
+void RouteOrch::releaseNextHops(NextHopSetId id)
+{
+    decreaseNextHopRefCount(id);
+    if (m_nextHopSets.get(id).ref_count == 0 && m_nextHopSets.get(id).next_hop_group_id)
+        removeNextHopGroup(id);
+    m_nextHopSets.collect(id);
+}
+
+bool RouteOrch::addNextHopGroup(NextHopSetId id)
 {
     SWSS_LOG_ENTER();
 
-    assert(!hasNextHopGroup(ipAddresses));
+    assert(!m_nextHopSets.get(id).next_hop_group_id);
 
-    if (m_nextHopGroupCount > NHGRP_MAX_SIZE)
+    if (isNextHopGroupTableFull())
     {
-        SWSS_LOG_DEBUG("Failed to create next hop group. Exceeding maximum number of next hop groups.\n");
+        TraceRing::record(TRACE_NHG_FULL, m_nextHopGroupCount);
         return false;
     }
 
     vector<sai_object_id_t> next_hop_ids;
-    set<IpAddress> next_hop_set = ipAddresses.getIpAddresses();
+    set<IpAddress> next_hop_set = m_nextHopSets.get(id).ip_addresses.getIpAddresses();
+    set<IpAddress> lost;
 
     /* Assert each IP address exists in m_syncdNextHops table,
-     * and add the corresponding next_hop_id to next_hop_ids. */
+     * and add the corresponding next_hop_id to next_hop_ids.
+     * Lost next hops start out pruned, as in the groups that had them. */
     for (auto it : next_hop_set)
     {
         if (!m_neighOrch->hasNextHop(it))
         {
-            SWSS_LOG_NOTICE("Failed to get next hop entry ip:%s",
-                    it.to_string().c_str());
+            TraceRing::record(TRACE_NHG_NO_NEXT_HOP, it.getV4Addr());
             return false;
         }
 
+        if (m_neighOrch->isNextHopLost(it))
+        {
+            lost.insert(it);
+            continue;
+        }
+
         sai_object_id_t next_hop_id = m_neighOrch->getNextHopId(it);
         next_hop_ids.push_back(next_hop_id);
     }
 
+    if (next_hop_ids.empty())
+    {
+        TraceRing::record(TRACE_NHG_NO_NEXT_HOP, lost.begin()->getV4Addr());
+        return false;
+    }
+
     sai_attribute_t nhg_attr;
     vector<sai_attribute_t> nhg_attrs;
 
@@ -207,45 +626,49 @@ bool RouteOrch::addNextHopGroup(IpAddresses ipAddresses)
     nhg_attrs.push_back(nhg_attr);
 
     sai_object_id_t next_hop_group_id;
+    SWSS_PROBE1(nhg_create_entry, next_hop_ids.size());
     sai_status_t status = sai_next_hop_group_api->
             create_next_hop_group(&next_hop_group_id, nhg_attrs.size(), nhg_attrs.data());
+    SWSS_PROBE3(nhg_create_return, next_hop_ids.size(), next_hop_group_id, status);
+    TraceRing::record(TRACE_NHG_CREATE, next_hop_group_id, next_hop_ids.size(), status);
     if (status != SAI_STATUS_SUCCESS)
     {
         SWSS_LOG_ERROR("Failed to create next hop group nh:%s\n",
-                       ipAddresses.to_string().c_str());
+                       m_nextHopSets.get(id).ip_addresses.to_string().c_str());
         return false;
     }
 
     m_nextHopGroupCount ++;
-    SWSS_LOG_NOTICE("Create next hop group nhgid:%llx nh:%s \n",
-                    next_hop_group_id, ipAddresses.to_string().c_str());
 
     /* Increate the ref_count for the next hops used by the next hop group. */
     for (auto it : next_hop_set)
-        m_neighOrch->increaseNextHopRefCount(it);
+    {
+        if (lost.find(it) == lost.end())
+            m_neighOrch->increaseNextHopRefCount(it);
+    }
 
-    /*
-     * Initialize the next hop gruop structure with ref_count as 0. This
-     * count will increase once the route is successfully syncd.
-     */
-    NextHopGroupEntry next_hop_group_entry;
-    next_hop_group_entry.next_hop_group_id = next_hop_group_id;
-    next_hop_group_entry.ref_count = 0;
-    m_syncdNextHopGroups[ipAddresses] = next_hop_group_entry;
+    /* The routes using the group hold the set's references */
+    m_nextHopSets.get(id).next_hop_group_id = next_hop_group_id;
+    m_nextHopSets.get(id).pruned = lost;
+    m_prunedMembers += lost.size();
 
     return true;
 }
 
-bool RouteOrch::removeNextHopGroup(IpAddresses ipAddresses)
+bool RouteOrch::removeNextHopGroup(NextHopSetId id)
 {
     SWSS_LOG_ENTER();
 
-    assert(hasNextHopGroup(ipAddresses));
+    NextHopSet &next_hops = m_nextHopSets.get(id);
+    assert(next_hops.next_hop_group_id);
 
-    if (m_syncdNextHopGroups[ipAddresses].ref_count == 0)
+    if (next_hops.ref_count == 0)
     {
-        sai_object_id_t next_hop_group_id = m_syncdNextHopGroups[ipAddresses].next_hop_group_id;
+        sai_object_id_t next_hop_group_id = next_hops.next_hop_group_id;
+        SWSS_PROBE1(nhg_remove_entry, next_hop_group_id);
         sai_status_t status = sai_next_hop_group_api->remove_next_hop_group(next_hop_group_id);
+        SWSS_PROBE2(nhg_remove_return, next_hop_group_id, status);
+        TraceRing::record(TRACE_NHG_REMOVE, next_hop_group_id, status);
         if (status != SAI_STATUS_SUCCESS)
         {
             SWSS_LOG_ERROR("Failed to remove next hop group nhgid:%llx\n", next_hop_group_id);
@@ -254,21 +677,117 @@ bool RouteOrch::removeNextHopGroup(IpAddresses ipAddresses)
 
         m_nextHopGroupCount --;
 
-        set<IpAddress> ip_address_set = ipAddresses.getIpAddresses();
+        /* Every waiting route gets a chance at the free slot */
+        if (!m_pendingGroups.empty())
+        {
+            Consumer &consumer = m_consumerMap.at(APP_ROUTE_TABLE_NAME);
+            for (auto &key : m_pendingGroups)
+                retryTask(consumer, key);
+            m_pendingGroups.clear();
+        }
+
+        /* Pruned members gave their reference back already */
+        set<IpAddress> ip_address_set = next_hops.ip_addresses.getIpAddresses();
         for (auto it : ip_address_set)
-            m_neighOrch->decreaseNextHopRefCount(it);
+        {
+            if (next_hops.pruned.find(it) == next_hops.pruned.end())
+                m_neighOrch->decreaseNextHopRefCount(it);
+        }
 
-        m_syncdNextHopGroups.erase(ipAddresses);
+        m_prunedMembers -= next_hops.pruned.size();
+        next_hops.pruned.clear();
+        next_hops.next_hop_group_id = 0;
     }
 
     return true;
 }
 
-void RouteOrch::addTempRoute(IpPrefix ipPrefix, IpAddresses nextHops)
+/*
+ * Take a lost next hop out of every next hop group holding it, so that the
+ * routes using the groups converge at once whatever their number. A group
+ * keeps its last member: its routes are left to be rewritten, like the
+ * routes using the next hop alone.
+ */
+void RouteOrch::pruneNextHop(const IpAddress &ipAddress)
+{
+    SWSS_LOG_ENTER();
+
+    if (!m_neighOrch->hasNextHop(ipAddress))
+        return;
+
+    sai_object_id_t next_hop_id = m_neighOrch->getNextHopId(ipAddress);
+    size_t groups = 0, routes = 0;
+
+    for (NextHopSetId id : m_nextHopSets.getSetsByNextHop(ipAddress))
+    {
+        NextHopSet &next_hops = m_nextHopSets.get(id);
+        if (!next_hops.next_hop_group_id ||
+            next_hops.pruned.find(ipAddress) != next_hops.pruned.end() ||
+            (int)next_hops.pruned.size() + 1 >= next_hops.ip_addresses.getSize())
+            continue;
+
+        sai_status_t status = sai_next_hop_group_api->
+                remove_next_hop_from_group(next_hops.next_hop_group_id, 1, &next_hop_id);
+        TraceRing::record(TRACE_NHG_MEMBER_REMOVE, next_hops.next_hop_group_id, next_hop_id, status);
+        if (status != SAI_STATUS_SUCCESS)
+        {
+            SWSS_LOG_ERROR("Failed to remove next hop %s from group nhgid:%llx\n",
+                           ipAddress.to_string().c_str(), next_hops.next_hop_group_id);
+            continue;
+        }
+
+        next_hops.pruned.insert(ipAddress);
+        m_neighOrch->decreaseNextHopRefCount(ipAddress);
+        m_prunedMembers ++;
+
+        groups ++;
+        routes += next_hops.ref_count;
+    }
+
+    if (groups)
+        SWSS_LOG_NOTICE("Pruned next hop %s from %zu groups used by %zu routes\n",
+                        ipAddress.to_string().c_str(), groups, routes);
+}
+
+/* Put a next hop that is back into the groups it was pruned from */
+void RouteOrch::restoreNextHop(const IpAddress &ipAddress)
+{
+    SWSS_LOG_ENTER();
+
+    if (!m_prunedMembers || !m_neighOrch->hasNextHop(ipAddress))
+        return;
+
+    /* The next hop may have been recreated under a new id */
+    sai_object_id_t next_hop_id = m_neighOrch->getNextHopId(ipAddress);
+
+    for (NextHopSetId id : m_nextHopSets.getSetsByNextHop(ipAddress))
+    {
+        NextHopSet &next_hops = m_nextHopSets.get(id);
+        if (!next_hops.next_hop_group_id ||
+            next_hops.pruned.find(ipAddress) == next_hops.pruned.end())
+            continue;
+
+        sai_status_t status = sai_next_hop_group_api->
+                add_next_hop_to_group(next_hops.next_hop_group_id, 1, &next_hop_id);
+        TraceRing::record(TRACE_NHG_MEMBER_ADD, next_hops.next_hop_group_id, next_hop_id, status);
+        if (status != SAI_STATUS_SUCCESS)
+        {
+            SWSS_LOG_ERROR("Failed to add next hop %s back to group nhgid:%llx\n",
+                           ipAddress.to_string().c_str(), next_hops.next_hop_group_id);
+            continue;
+        }
+
+        next_hops.pruned.erase(ipAddress);
+        m_neighOrch->increaseNextHopRefCount(ipAddress);
+        m_prunedMembers --;
+    }
+}
+
+void RouteOrch::addTempRoute(IpPrefix ipPrefix, NextHopSetId nextHops)
 {
     bool to_add = false;
     auto it_route = m_syncdRoutes.find(ipPrefix);
-    auto next_hop_set = nextHops.getIpAddresses();
+    auto next_hop_set = m_nextHopSets.get(nextHops).ip_addresses.getIpAddresses();
 
     /*
      * A temporary entry is added when route is not in m_syncdRoutes,
@@ -277,7 +796,7 @@ void RouteOrch::addTempRoute(IpPrefix ipPrefix, IpAddresses nextHops)
      */
     if (it_route != m_syncdRoutes.end())
     {
-        auto tmp_set = m_syncdRoutes[ipPrefix].getIpAddresses();
+        auto tmp_set = m_nextHopSets.get(it_route->second.next_hops).ip_addresses.getIpAddresses();
         for (auto it : tmp_set)
         {
             if (next_hop_set.find(it) == next_hop_set.end())
@@ -289,13 +808,13 @@ void RouteOrch::addTempRoute(IpPrefix ipPrefix, IpAddresses nextHops)
 
     if (to_add)
     {
-        /* Remove next hops that are not in m_syncdNextHops */
+        /* Remove next hops that are not in m_syncdNextHops or lost */
         for (auto it = next_hop_set.begin(); it != next_hop_set.end();)
         {
-            if (!m_neighOrch->hasNextHop(*it))
+            if (!m_neighOrch->hasNextHop(*it) || m_neighOrch->isNextHopLost(*it))
             {
-                SWSS_LOG_NOTICE("Failed to get next hop entry ip:%s",
-                       (*it).to_string().c_str());
+                TraceRing::record(TRACE_ROUTE_NO_NEXT_HOP, ipPrefix.getIp().getV4Addr(),
+                                  ipPrefix.getMask().getV4Addr(), it->getV4Addr());
                 it = next_hop_set.erase(it);
             }
             else
@@ -311,38 +830,34 @@ void RouteOrch::addTempRoute(IpPrefix ipPrefix, IpAddresses nextHops)
         advance(it, rand() % next_hop_set.size());
 
         /* Set the route's temporary next hop to be the randomly picked one */
-        IpAddresses tmp_next_hop((*it).to_string());
-        addRoute(ipPrefix, tmp_next_hop);
+        NextHopSetId tmp_next_hop = m_nextHopSets.intern(IpAddresses((*it).to_string()));
+        if (!addRoute(ipPrefix, tmp_next_hop))
+            m_nextHopSets.collect(tmp_next_hop);
     }
 }
 
-bool RouteOrch::addRoute(IpPrefix ipPrefix, IpAddresses nextHops)
+bool RouteOrch::resolveNextHops(IpPrefix ipPrefix, NextHopSetId nextHops, sai_object_id_t &next_hop_id)
 {
-    SWSS_LOG_ENTER();
-
-    /* next_hop_id indicates the next hop id or next hop group id of this route */
-    sai_object_id_t next_hop_id;
-    auto it_route = m_syncdRoutes.find(ipPrefix);
-
     /* The route is pointing to a next hop */
-    if (nextHops.getSize() == 1)
+    if (m_nextHopSets.get(nextHops).ip_addresses.getSize() == 1)
     {
-        IpAddress ip_address(nextHops.to_string());
-        if (m_neighOrch->hasNextHop(ip_address))
+        IpAddress ip_address(m_nextHopSets.get(nextHops).ip_addresses.to_string());
+        /* A lost next hop is on its way out, like a missing one */
+        if (m_neighOrch->hasNextHop(ip_address) && !m_neighOrch->isNextHopLost(ip_address))
         {
             next_hop_id = m_neighOrch->getNextHopId(ip_address);
         }
         else
         {
-            SWSS_LOG_NOTICE("Failed to get next hop entry ip:%s",
-                    nextHops.to_string().c_str());
+            TraceRing::record(TRACE_ROUTE_NO_NEXT_HOP, ipPrefix.getIp().getV4Addr(),
+                              ipPrefix.getMask().getV4Addr(), ip_address.getV4Addr());
             return false;
         }
     }
     /* The route is pointing to a next hop group */
     else
     {
-        if (!hasNextHopGroup(nextHops)) /* Create a new next hop group */
+        if (!m_nextHopSets.get(nextHops).next_hop_group_id) /* Create a new next hop group */
         {
             if (!addNextHopGroup(nextHops))
             {
@@ -353,9 +868,23 @@ bool RouteOrch::addRoute(IpPrefix ipPrefix, IpAddresses nextHops)
             }
         }
 
-        next_hop_id = m_syncdNextHopGroups[nextHops].next_hop_group_id;
+        next_hop_id = m_nextHopSets.get(nextHops).next_hop_group_id;
     }
 
+    return true;
+}
+
+bool RouteOrch::addRoute(IpPrefix ipPrefix, NextHopSetId nextHops)
+{
+    SWSS_LOG_ENTER();
+
+    /* next_hop_id indicates the next hop id or next hop group id of this route */
+    sai_object_id_t next_hop_id;
+    auto it_route = m_syncdRoutes.find(ipPrefix);
+
+    if (!resolveNextHops(ipPrefix, nextHops, next_hop_id))
+        return false;
+
     /* Sync the route entry */
     sai_unicast_route_entry_t route_entry;
     route_entry.vr_id = gVirtualRouterId;
@@ -375,13 +904,17 @@ bool RouteOrch::addRoute(IpPrefix ipPrefix, IpAddresses nextHops)
      */
     if (it_route == m_syncdRoutes.end())
     {
+        SWSS_PROBE3(route_create_entry, route_entry.destination.addr.ip4, route_entry.destination.mask.ip4, next_hop_id);
         sai_status_t status = sai_route_api->create_route(&route_entry, 1, &route_attr);
+        SWSS_PROBE3(route_create_return, route_entry.destination.addr.ip4, route_entry.destination.mask.ip4, status);
+        TraceRing::record(TRACE_ROUTE_CREATE, route_entry.destination.addr.ip4,
+                          route_entry.destination.mask.ip4, next_hop_id, status);
         if (status != SAI_STATUS_SUCCESS)
         {
             SWSS_LOG_ERROR("Failed to create route %s with next hop(s) %s",
-                    ipPrefix.to_string().c_str(), nextHops.to_string().c_str());
+                    ipPrefix.to_string().c_str(), m_nextHopSets.get(nextHops).ip_addresses.to_string().c_str());
             /* Clean up the newly created next hop group entry */
-            if (nextHops.getSize() > 1)
+            if (m_nextHopSets.get(nextHops).next_hop_group_id)
             {
                 removeNextHopGroup(nextHops);
             }
@@ -390,73 +923,27 @@ bool RouteOrch::addRoute(IpPrefix ipPrefix, IpAddresses nextHops)
 
         /* Increase the ref_count for the next hop (group) entry */
         increaseNextHopRefCount(nextHops);
-        SWSS_LOG_INFO("Create route %s with next hop(s) %s",
-                ipPrefix.to_string().c_str(), nextHops.to_string().c_str());
+        setSyncdRoute(ipPrefix, nextHops);
     }
     else
     {
+        SWSS_PROBE3(route_set_entry, route_entry.destination.addr.ip4, route_entry.destination.mask.ip4, next_hop_id);
         sai_status_t status = sai_route_api->set_route_attribute(&route_entry, &route_attr);
+        SWSS_PROBE3(route_set_return, route_entry.destination.addr.ip4, route_entry.destination.mask.ip4, status);
+        TraceRing::record(TRACE_ROUTE_SET, route_entry.destination.addr.ip4,
+                          route_entry.destination.mask.ip4, next_hop_id, status);
         if (status != SAI_STATUS_SUCCESS)
         {
             SWSS_LOG_ERROR("Failed to set route %s with next hop(s) %s",
-                    ipPrefix.to_string().c_str(), nextHops.to_string().c_str());
+                    ipPrefix.to_string().c_str(), m_nextHopSets.get(nextHops).ip_addresses.to_string().c_str());
             return false;
         }
 
         /* Increase the ref_count for the next hop (group) entry */
         increaseNextHopRefCount(nextHops);
 
-        decreaseNextHopRefCount(it_route->second);
-        if (it_route->second.getSize() > 1
-            && m_syncdNextHopGroups[it_route->second].ref_count == 0)
-        {
-            removeNextHopGroup(it_route->second);
-        }
-        SWSS_LOG_INFO("Set route %s with next hop(s) %s",
-                ipPrefix.to_string().c_str(), nextHops.to_string().c_str());
-    }
-
-    m_syncdRoutes[ipPrefix] = nextHops;
-    return true;
-}
-
-bool RouteOrch::removeRoute(IpPrefix ipPrefix)
-{
-    SWSS_LOG_ENTER();
-
-    sai_unicast_route_entry_t route_entry;
-    route_entry.vr_id = gVirtualRouterId;
-    route_entry.destination.addr_family = SAI_IP_ADDR_FAMILY_IPV4;
-    route_entry.destination.addr.ip4 = ipPrefix.getIp().getV4Addr();
-    route_entry.destination.mask.ip4 = ipPrefix.getMask().getV4Addr();
-
-    sai_status_t status = sai_route_api->remove_route(&route_entry);
-    if (status != SAI_STATUS_SUCCESS)
-    {
-        SWSS_LOG_ERROR("Failed to remove route prefix:%s\n", ipPrefix.to_string().c_str());
-        return false;
-    }
-
-    /* Remove next hop group entry if ref_count is zero */
-    auto it_route = m_syncdRoutes.find(ipPrefix);
-    if (it_route != m_syncdRoutes.end())
-    {
-        /*
-         * Decrease the reference count only when the route is pointing to a next hop.
-         * Decrease the reference count when the route is pointing to a next hop group,
-         * and check wheather the reference count decreases to zero. If yes, then we need
-         * to remove the next hop group.
-         */
-        decreaseNextHopRefCount(it_route->second);
-        if (it_route->second.getSize() > 1
-            && m_syncdNextHopGroups[it_route->second].ref_count == 0)
-        {
-            removeNextHopGroup(it_route->second);
-        }
+        releaseNextHops(setSyncdRoute(ipPrefix, nextHops));
     }
-    SWSS_LOG_INFO("Remove route %s with next hop(s) %s",
-            ipPrefix.to_string().c_str(), it_route->second.to_string().c_str());
 
-    m_syncdRoutes.erase(ipPrefix);
     return true;
 }
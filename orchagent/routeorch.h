@@ -2,14 +2,19 @@
 #define SWSS_ROUTEORCH_H
 
 #include "orch.h"
+#include "observer.h"
+#include "saibulk.h"
+#include "nexthopsets.h"
 #include "intfsorch.h"
 #include "neighorch.h"
 
 #include "ipaddress.h"
 #include "ipaddresses.h"
 #include "ipprefix.h"
+#include "common/histogram.h"
 
 #include <map>
+#include <vector>
 
 using namespace std;
 using namespace swss;
@@ -17,18 +22,65 @@ using namespace swss;
 /* Maximum next hop group number */
 #define NHGRP_MAX_SIZE 128
 
-struct NextHopGroupEntry
+/* FPM to SAI latency is kept for CONVERGENCE_SLOTS windows of CONVERGENCE_SLOT_SEC seconds */
+#define CONVERGENCE_SLOTS           6
+#define CONVERGENCE_SLOT_SEC        10
+/* Routes slower than this (us) from FPM to SAI are traced, one in CONVERGENCE_TRACE_SAMPLE */
+#define CONVERGENCE_SLOW_THRESHOLD  1000000
+#define CONVERGENCE_TRACE_SAMPLE    16
+
+/* Maximum number of routes programmed by one bulk call */
+#define ROUTE_BULK_MAX_SIZE         1024
+
+/* Synced routes checked per turn by the sweep closing a resync, which
+ * removes at most the budget left of the turn */
+#define ROUTE_RESYNC_SWEEP_SLICE    4096
+
+/* Route task decoded on its first pass */
+struct RouteTaskCache : public TaskCache
+{
+    RouteTaskCache() : timestamp(0) {}
+
+    IpPrefix            ip_prefix;      // destination network
+    IpAddresses         ip_addresses;   // next hop IP address(es)
+    string              alias;          // outgoing interface alias(es)
+    uint64_t            timestamp;      // FPM receive time (us since the epoch), 0 if not stamped
+};
+
+/* Bulk route operations, in the order they are flushed */
+enum RouteBulkOp
 {
-    sai_object_id_t     next_hop_group_id;  // next hop group id
-    int                 ref_count;          // reference count
+    ROUTE_BULK_REMOVE,
+    ROUTE_BULK_SET,
+    ROUTE_BULK_CREATE,
+    ROUTE_BULK_OP_MAX
 };
 
-/* NextHopGroupTable: next hop group IP addersses, NextHopGroupEntry */
-typedef map<IpAddresses, NextHopGroupEntry> NextHopGroupTable;
-/* RouteTable: destination network, next hop IP address(es) */
-typedef map<IpPrefix, IpAddresses> RouteTable;
+/*
+ * Route queued for the next bulk call. A queued create or set already holds
+ * a reference on its next hop (group), released if the call fails.
+ */
+struct RouteBulkEntry
+{
+    RouteBulkEntry() : next_hops(NEXT_HOP_SET_NONE), next_hop_id(0) {}
+
+    SyncMap::iterator   task;           // route task in m_toSync
+    NextHopSetId        next_hops;      // next hop(s) of a create or set
+    sai_object_id_t     next_hop_id;    // next hop (group) id of a create or set
+};
 
-class RouteOrch : public Orch
+struct RouteEntry
+{
+    RouteEntry(NextHopSetId id, uint32_t gen) : next_hops(id), generation(gen) {}
+
+    NextHopSetId        next_hops;      // interned next hop IP address(es)
+    uint32_t            generation;     // resync generation the route was last refreshed in
+};
+
+/* RouteTable: destination network, RouteEntry */
+typedef CountingMap<IpPrefix, RouteEntry> RouteTable;
+
+class RouteOrch : public Orch, public Observer
 {
 public:
     RouteOrch(DBConnector *db, string tableName,
@@ -37,29 +89,109 @@ public:
         m_portsOrch(portsOrch),
         m_neighOrch(neighOrch),
         m_nextHopGroupCount(0),
-        m_resync(false) {};
+        m_prunedMembers(0),
+        m_resync(false),
+        m_sweeping(false),
+        m_generation(0),
+        m_sweepCursor(),
+        m_syncdRoutes(RouteTable::allocator_type(&m_routeMemory)),
+        m_bulkSize(0),
+        m_convergence(CONVERGENCE_SLOT_SEC),
+        m_slowRoutes(0) {};
+
+    bool hasNextHopGroup(const IpAddresses &) const;
+
+    /* FPM to SAI latency (ns) of the routes programmed over the last
+     * CONVERGENCE_SLOTS * CONVERGENCE_SLOT_SEC seconds */
+    LatencyHistogram getConvergence() const;
+    uint64_t getConvergenceWindowSec() const { return m_convergence.getWindowSec(); }
+    /* Routes above CONVERGENCE_SLOW_THRESHOLD since start */
+    uint64_t getSlowRouteCount() const { return m_slowRoutes; }
+
+    void dumpState(vector<FieldValueTuple> &fvs);
+    void getMemoryStats(vector<pair<string, const AllocStats *>> &stats);
 
-    bool hasNextHopGroup(IpAddresses);
+    /* Synced and queued routes using a next hop, alone or in a group */
+    size_t getRouteCount(const IpAddress &) const;
+
+    void update(SubjectType type, void *cntx);
 
 private:
     PortsOrch *m_portsOrch;
     NeighOrch *m_neighOrch;
 
     int m_nextHopGroupCount;
+    /* Lost next hops currently taken out of next hop groups */
+    size_t m_prunedMembers;
     bool m_resync;
-
+    /*
+     * A resync bumps m_generation and the routes refreshed until it
+     * completes are stamped with it; the sweep then removes the others,
+     * one slice per turn from m_sweepCursor on.
+     */
+    bool m_sweeping;
+    uint32_t m_generation;
+    IpPrefix m_sweepCursor;
+
+    AllocStats m_routeMemory;
     RouteTable m_syncdRoutes;
-    NextHopGroupTable m_syncdNextHopGroups;
-
-    void increaseNextHopRefCount(IpAddresses);
-    void decreaseNextHopRefCount(IpAddresses);
-
-    bool addNextHopGroup(IpAddresses);
-    bool removeNextHopGroup(IpAddresses);
-
-    void addTempRoute(IpPrefix, IpAddresses);
-    bool addRoute(IpPrefix, IpAddresses);
-    bool removeRoute(IpPrefix);
+    /* Next hop sets of the routes, with their next hop groups */
+    NextHopSetPool m_nextHopSets;
+
+    /* Parked route task keys indexed by the next hop they are waiting for */
+    map<IpAddress, set<string>> m_pendingNextHops;
+    /* The next hops each parked route task key is waiting for, to unregister
+     * it once the task is handled again */
+    map<string, vector<IpAddress>> m_pendingKeys;
+    /* Parked route task keys waiting for a next hop group to be removed */
+    set<string> m_pendingGroups;
+
+    /* Routes queued by the current doTask pass, see flushRoutes */
+    vector<RouteBulkEntry> m_bulkRoutes[ROUTE_BULK_OP_MAX];
+    size_t m_bulkSize;
+
+    /* Rolling FPM to SAI latency, one histogram per window */
+    WindowedHistogram<CONVERGENCE_SLOTS> m_convergence;
+    uint64_t m_slowRoutes;
+
+    void increaseNextHopRefCount(NextHopSetId);
+    void decreaseNextHopRefCount(NextHopSetId);
+    /* Drop a reference on a next hop (group), removing the group once unused */
+    void releaseNextHops(NextHopSetId);
+
+    bool isNextHopGroupTableFull() const { return m_nextHopGroupCount > NHGRP_MAX_SIZE; }
+    bool addNextHopGroup(NextHopSetId);
+    bool removeNextHopGroup(NextHopSetId);
+    /* Take a lost next hop out of, or put it back into, its next hop groups */
+    void pruneNextHop(const IpAddress &);
+    void restoreNextHop(const IpAddress &);
+
+    /* Point the synced route of a prefix at a next hop set and stamp it
+     * with the current generation; returns the set it used before, if any */
+    NextHopSetId setSyncdRoute(const IpPrefix &, NextHopSetId);
+
+    bool resolveNextHops(IpPrefix, NextHopSetId, sai_object_id_t &);
+    void addTempRoute(IpPrefix, NextHopSetId);
+    bool addRoute(IpPrefix, NextHopSetId);
+
+    /* Queue a route task for the next bulk call, false if its next hops
+     * cannot be resolved yet */
+    bool queueRoute(Consumer &consumer, SyncMap::iterator task, RouteBulkOp op);
+    /* Program the queued routes and complete or keep their tasks */
+    void flushRoutes(Consumer &consumer);
+    void completeRoute(Consumer &consumer, RouteBulkOp op, RouteBulkEntry &entry,
+                       const sai_unicast_route_entry_t &route_entry, sai_status_t status);
+
+    /* Queue the removal of the next slice of routes left stale by the resync,
+     * within what is left of the turn */
+    void sweepRoutes(Consumer &consumer);
+
+    /* Stop waiting for next hops on behalf of a route task key */
+    void clearPendingNextHops(const string &key);
+
+    RouteTaskCache &getTaskCache(SyncTask &task);
+    /* Account the FPM to SAI latency of a route task that was just programmed */
+    void recordConvergence(const SyncTask &task, const RouteTaskCache &cache);
 
     void doTask(Consumer& consumer);
 };
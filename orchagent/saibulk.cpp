@@ -0,0 +1,60 @@
+#include "saibulk.h"
+
+extern sai_route_api_t*             sai_route_api;
+
+static sai_status_t emulate_create_routes(uint32_t object_count,
+                                          const sai_unicast_route_entry_t *route_entry,
+                                          const uint32_t *attr_count,
+                                          const sai_attribute_t **attr_list,
+                                          sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = sai_route_api->create_route(&route_entry[i], attr_count[i], attr_list[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+static sai_status_t emulate_remove_routes(uint32_t object_count,
+                                          const sai_unicast_route_entry_t *route_entry,
+                                          sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = sai_route_api->remove_route(&route_entry[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+static sai_status_t emulate_set_routes_attribute(uint32_t object_count,
+                                                 const sai_unicast_route_entry_t *route_entry,
+                                                 const sai_attribute_t *attr_list,
+                                                 sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = sai_route_api->set_route_attribute(&route_entry[i], &attr_list[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+sai_route_bulk_api_t emulated_route_bulk_api = {
+    emulate_create_routes,
+    emulate_remove_routes,
+    emulate_set_routes_attribute
+};
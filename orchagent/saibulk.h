@@ -0,0 +1,46 @@
+#ifndef SWSS_SAIBULK_H
+#define SWSS_SAIBULK_H
+
+extern "C" {
+#include "sai.h"
+#include "saistatus.h"
+}
+
+#include <stdint.h>
+
+/*
+ * Bulk route API, modelled on the bulk functions of later SAI versions
+ * which the SAI headers orchagent builds against do not have yet. Every
+ * entry is attempted and gets its own status in object_statuses; the call
+ * returns SAI_STATUS_SUCCESS only if all the entries succeeded.
+ */
+typedef sai_status_t (*sai_bulk_create_route_fn)(
+        uint32_t object_count,
+        const sai_unicast_route_entry_t *route_entry,
+        const uint32_t *attr_count,
+        const sai_attribute_t **attr_list,
+        sai_status_t *object_statuses);
+
+typedef sai_status_t (*sai_bulk_remove_route_fn)(
+        uint32_t object_count,
+        const sai_unicast_route_entry_t *route_entry,
+        sai_status_t *object_statuses);
+
+typedef sai_status_t (*sai_bulk_set_route_attribute_fn)(
+        uint32_t object_count,
+        const sai_unicast_route_entry_t *route_entry,
+        const sai_attribute_t *attr_list,
+        sai_status_t *object_statuses);
+
+typedef struct _sai_route_bulk_api_t
+{
+    sai_bulk_create_route_fn            create_routes;
+    sai_bulk_remove_route_fn            remove_routes;
+    sai_bulk_set_route_attribute_fn     set_routes_attribute;
+} sai_route_bulk_api_t;
+
+/* Bulk route API issuing one sai_route_api call per entry, for SAI
+ * implementations without bulk support */
+extern sai_route_bulk_api_t emulated_route_bulk_api;
+
+#endif /* SWSS_SAIBULK_H */
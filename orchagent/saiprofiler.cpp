@@ -0,0 +1,203 @@
+#include "saiprofiler.h"
+#include "saibulk.h"
+
+#include "logger.h"
+
+using namespace std;
+using namespace swss;
+
+extern sai_switch_api_t*            sai_switch_api;
+extern sai_port_api_t*              sai_port_api;
+extern sai_vlan_api_t*              sai_vlan_api;
+extern sai_router_interface_api_t*  sai_router_intfs_api;
+extern sai_hostif_api_t*            sai_hostif_api;
+extern sai_neighbor_api_t*          sai_neighbor_api;
+extern sai_next_hop_api_t*          sai_next_hop_api;
+extern sai_next_hop_group_api_t*    sai_next_hop_group_api;
+extern sai_route_api_t*             sai_route_api;
+extern sai_lag_api_t*               sai_lag_api;
+extern sai_route_bulk_api_t*        sai_route_bulk_api;
+
+bool SaiProfiler::m_enabled = false;
+volatile sig_atomic_t SaiProfiler::m_dumpRequested = 0;
+vector<SaiCallStats> SaiProfiler::m_stats;
+
+/*
+ * One instance per wrapped function: id only tells the instances apart, the
+ * original function pointer and the statistics slot are kept as statics.
+ */
+template <int id, typename... Args>
+struct SaiProfiledCall
+{
+    static sai_status_t (*original)(Args...);
+    static size_t index;
+
+    static sai_status_t call(Args... args)
+    {
+        auto start = chrono::steady_clock::now();
+        sai_status_t status = original(args...);
+        SaiProfiler::record(index, status, chrono::steady_clock::now() - start);
+        return status;
+    }
+};
+
+template <int id, typename... Args>
+sai_status_t (*SaiProfiledCall<id, Args...>::original)(Args...);
+template <int id, typename... Args>
+size_t SaiProfiledCall<id, Args...>::index;
+
+template <int id, typename... Args>
+static void wrapCall(sai_status_t (*&fn)(Args...), const char *name)
+{
+    if (!fn)
+        return;
+
+    SaiProfiledCall<id, Args...>::original = fn;
+    SaiProfiledCall<id, Args...>::index = SaiProfiler::addCall(name);
+    fn = &SaiProfiledCall<id, Args...>::call;
+}
+
+#define SAI_PROFILE(api, fn) wrapCall<__LINE__>(api.fn, #api "." #fn)
+
+/*
+ * Copy an API table and point the global pointer to the copy. A table that
+ * could not be queried stays NULL; its zeroed copy leaves nothing to wrap.
+ */
+#define SAI_PROFILE_TABLE_COPY(type, ptr)   \
+    static type ptr##_copy;                 \
+    if (ptr)                                \
+    {                                       \
+        ptr##_copy = *ptr;                  \
+        ptr = &ptr##_copy;                  \
+    }
+
+/* Only the functions called by the orchs are wrapped */
+void SaiProfiler::wrapApis()
+{
+    SWSS_LOG_ENTER();
+
+    if (m_enabled)
+        return;
+
+    SAI_PROFILE_TABLE_COPY(sai_switch_api_t,            sai_switch_api);
+    SAI_PROFILE_TABLE_COPY(sai_port_api_t,              sai_port_api);
+    SAI_PROFILE_TABLE_COPY(sai_vlan_api_t,              sai_vlan_api);
+    SAI_PROFILE_TABLE_COPY(sai_router_interface_api_t,  sai_router_intfs_api);
+    SAI_PROFILE_TABLE_COPY(sai_hostif_api_t,            sai_hostif_api);
+    SAI_PROFILE_TABLE_COPY(sai_neighbor_api_t,          sai_neighbor_api);
+    SAI_PROFILE_TABLE_COPY(sai_next_hop_api_t,          sai_next_hop_api);
+    SAI_PROFILE_TABLE_COPY(sai_next_hop_group_api_t,    sai_next_hop_group_api);
+    SAI_PROFILE_TABLE_COPY(sai_route_api_t,             sai_route_api);
+    SAI_PROFILE_TABLE_COPY(sai_lag_api_t,               sai_lag_api);
+    SAI_PROFILE_TABLE_COPY(sai_route_bulk_api_t,        sai_route_bulk_api);
+
+    SAI_PROFILE(sai_switch_api_copy, initialize_switch);
+    SAI_PROFILE(sai_switch_api_copy, set_switch_attribute);
+    SAI_PROFILE(sai_switch_api_copy, get_switch_attribute);
+    SAI_PROFILE(sai_port_api_copy, set_port_attribute);
+    SAI_PROFILE(sai_port_api_copy, get_port_attribute);
+    SAI_PROFILE(sai_vlan_api_copy, create_vlan);
+    SAI_PROFILE(sai_vlan_api_copy, remove_vlan);
+    SAI_PROFILE(sai_vlan_api_copy, get_vlan_attribute);
+    SAI_PROFILE(sai_vlan_api_copy, create_vlan_member);
+    SAI_PROFILE(sai_vlan_api_copy, remove_vlan_member);
+    SAI_PROFILE(sai_router_intfs_api_copy, create_router_interface);
+    SAI_PROFILE(sai_router_intfs_api_copy, remove_router_interface);
+    SAI_PROFILE(sai_hostif_api_copy, create_hostif);
+    SAI_PROFILE(sai_hostif_api_copy, set_trap_attribute);
+    SAI_PROFILE(sai_neighbor_api_copy, create_neighbor_entry);
+    SAI_PROFILE(sai_neighbor_api_copy, remove_neighbor_entry);
+    SAI_PROFILE(sai_next_hop_api_copy, create_next_hop);
+    SAI_PROFILE(sai_next_hop_api_copy, remove_next_hop);
+    SAI_PROFILE(sai_next_hop_group_api_copy, create_next_hop_group);
+    SAI_PROFILE(sai_next_hop_group_api_copy, remove_next_hop_group);
+    SAI_PROFILE(sai_next_hop_group_api_copy, add_next_hop_to_group);
+    SAI_PROFILE(sai_next_hop_group_api_copy, remove_next_hop_from_group);
+    SAI_PROFILE(sai_route_api_copy, create_route);
+    SAI_PROFILE(sai_route_api_copy, remove_route);
+    SAI_PROFILE(sai_route_api_copy, set_route_attribute);
+    SAI_PROFILE(sai_route_bulk_api_copy, create_routes);
+    SAI_PROFILE(sai_route_bulk_api_copy, remove_routes);
+    SAI_PROFILE(sai_route_bulk_api_copy, set_routes_attribute);
+    SAI_PROFILE(sai_lag_api_copy, create_lag);
+    SAI_PROFILE(sai_lag_api_copy, remove_lag);
+    SAI_PROFILE(sai_lag_api_copy, create_lag_member);
+    SAI_PROFILE(sai_lag_api_copy, remove_lag_member);
+
+    signal(SIGUSR1, SaiProfiler::onSignal);
+    m_enabled = true;
+
+    SWSS_LOG_NOTICE("Profiling %zu SAI functions\n", m_stats.size());
+}
+
+size_t SaiProfiler::addCall(const char *name)
+{
+    /* Drop the "sai_" prefix and "_api_copy" suffix of the table name */
+    string n = name;
+    size_t pos = n.find("_api_copy.");
+    if (pos != string::npos)
+        n = n.substr(4, pos - 4) + n.substr(pos + 9);
+
+    m_stats.push_back({ n, 0, LatencyHistogram() });
+    return m_stats.size() - 1;
+}
+
+void SaiProfiler::record(size_t index, sai_status_t status,
+                         chrono::steady_clock::duration elapsed)
+{
+    SaiCallStats &stats = m_stats[index];
+
+    stats.latency.add(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    if (status != SAI_STATUS_SUCCESS)
+        stats.failures++;
+}
+
+void SaiProfiler::publish(Table &table)
+{
+    for (auto &stats : m_stats)
+    {
+        if (!stats.latency.getCount())
+            continue;
+
+        vector<FieldValueTuple> fvs;
+        fvs.push_back(FieldValueTuple("count", to_string(stats.latency.getCount())));
+        fvs.push_back(FieldValueTuple("failures", to_string(stats.failures)));
+        fvs.push_back(FieldValueTuple("p50_ns", to_string(stats.latency.getPercentile(50))));
+        fvs.push_back(FieldValueTuple("p99_ns", to_string(stats.latency.getPercentile(99))));
+        fvs.push_back(FieldValueTuple("max_ns", to_string(stats.latency.getMax())));
+        table.set(stats.name, fvs);
+    }
+}
+
+void SaiProfiler::onSignal(int signo)
+{
+    m_dumpRequested = 1;
+}
+
+void SaiProfiler::handleDumpRequest()
+{
+    if (!m_dumpRequested)
+        return;
+
+    m_dumpRequested = 0;
+    dump();
+}
+
+void SaiProfiler::dump()
+{
+    SWSS_LOG_ENTER();
+
+    for (auto &stats : m_stats)
+    {
+        if (!stats.latency.getCount())
+            continue;
+
+        SWSS_LOG_NOTICE("SAI %s count:%llu failures:%llu p50:%lluns p99:%lluns max:%lluns\n",
+                        stats.name.c_str(),
+                        (unsigned long long)stats.latency.getCount(),
+                        (unsigned long long)stats.failures,
+                        (unsigned long long)stats.latency.getPercentile(50),
+                        (unsigned long long)stats.latency.getPercentile(99),
+                        (unsigned long long)stats.latency.getMax());
+    }
+}
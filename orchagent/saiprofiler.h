@@ -0,0 +1,58 @@
+#ifndef SWSS_SAIPROFILER_H
+#define SWSS_SAIPROFILER_H
+
+extern "C" {
+#include "sai.h"
+#include "saistatus.h"
+}
+
+#include "table.h"
+#include "common/histogram.h"
+
+#include <signal.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace swss;
+
+#define SAI_PROFILE_TABLE "SAI_PROFILE"
+
+struct SaiCallStats
+{
+    string              name;       // api table and function
+    uint64_t            failures;   // calls not returning SAI_STATUS_SUCCESS
+    LatencyHistogram    latency;    // call latency (ns), one sample per call
+};
+
+/*
+ * Optional interposition layer between the orchs and the SAI library. Once
+ * wrapApis() is called, the global sai_*_api pointers refer to copies of the
+ * API tables whose functions record their latency before returning.
+ */
+class SaiProfiler
+{
+public:
+    static void wrapApis();
+    static bool isEnabled() { return m_enabled; }
+
+    static size_t addCall(const char *name);
+    static void record(size_t index, sai_status_t status,
+                       chrono::steady_clock::duration elapsed);
+
+    /* Write one entry per called function to the SAI_PROFILE table */
+    static void publish(Table &table);
+    /* Log the statistics if a dump was requested by SIGUSR1 */
+    static void handleDumpRequest();
+    static void dump();
+
+private:
+    static bool m_enabled;
+    static volatile sig_atomic_t m_dumpRequested;
+    static vector<SaiCallStats> m_stats;
+
+    static void onSignal(int signo);
+};
+
+#endif /* SWSS_SAIPROFILER_H */
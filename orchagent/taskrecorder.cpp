@@ -0,0 +1,234 @@
+#include "taskrecorder.h"
+
+#include "logger.h"
+
+#include <chrono>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace swss;
+
+int TaskRecorder::m_fd = -1;
+string TaskRecorder::m_buffer;
+uint64_t TaskRecorder::m_last = 0;
+
+static uint64_t unixTimeNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void putVarint(string &buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf += (char)(value | 0x80);
+        value >>= 7;
+    }
+    buf += (char)value;
+}
+
+static void putString(string &buf, const string &value)
+{
+    putVarint(buf, value.size());
+    buf += value;
+}
+
+bool TaskRecorder::open(const string &path)
+{
+    SWSS_LOG_ENTER();
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        SWSS_LOG_ERROR("Failed to open task record file %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    /* Only ever append to a task record, never to some other file */
+    bool empty = lseek(fd, 0, SEEK_END) == 0;
+    char magic[TASK_RECORD_MAGIC_SIZE];
+    if (!empty && (pread(fd, magic, sizeof(magic), 0) != sizeof(magic) ||
+                   memcmp(magic, TASK_RECORD_MAGIC, sizeof(magic))))
+    {
+        SWSS_LOG_ERROR("%s exists and is not a task record file\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_buffer.reserve(TASK_RECORD_BUFFER_SIZE);
+
+    if (empty)
+        m_buffer.append(TASK_RECORD_MAGIC, TASK_RECORD_MAGIC_SIZE);
+
+    m_last = unixTimeNs();
+    m_buffer += TASK_RECORD_SEGMENT;
+    putVarint(m_buffer, m_last);
+    flush();
+
+    SWSS_LOG_NOTICE("Recording popped tasks to %s\n", path.c_str());
+    return true;
+}
+
+void TaskRecorder::record(const string &table, const KeyOpFieldsValuesTuple &entry)
+{
+    uint64_t now = unixTimeNs();
+
+    m_buffer += TASK_RECORD_TASK;
+    putVarint(m_buffer, now > m_last ? now - m_last : 0);
+    m_last = max(now, m_last);
+
+    putString(m_buffer, table);
+    putString(m_buffer, kfvKey(entry));
+    putString(m_buffer, kfvOp(entry));
+    putVarint(m_buffer, kfvFieldsValues(entry).size());
+    for (auto &fv : kfvFieldsValues(entry))
+    {
+        putString(m_buffer, fvField(fv));
+        putString(m_buffer, fvValue(fv));
+    }
+
+    if (m_buffer.size() >= TASK_RECORD_BUFFER_SIZE)
+        flush();
+}
+
+void TaskRecorder::flush()
+{
+    if (m_fd < 0 || m_buffer.empty())
+        return;
+
+    size_t done = 0;
+    while (done < m_buffer.size())
+    {
+        ssize_t n = write(m_fd, m_buffer.data() + done, m_buffer.size() - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            /* Stop recording rather than leave a torn record behind */
+            SWSS_LOG_ERROR("Failed to write task record file, recording stopped: %s\n", strerror(errno));
+            close(m_fd);
+            m_fd = -1;
+            break;
+        }
+        done += n;
+    }
+    m_buffer.clear();
+}
+
+TaskRecordReader::TaskRecordReader() :
+    m_file(NULL),
+    m_last(0),
+    m_newSegment(false)
+{
+}
+
+TaskRecordReader::~TaskRecordReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+bool TaskRecordReader::open(const string &path)
+{
+    SWSS_LOG_ENTER();
+
+    m_file = fopen(path.c_str(), "rb");
+    if (!m_file)
+    {
+        SWSS_LOG_ERROR("Failed to open task record file %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    char magic[TASK_RECORD_MAGIC_SIZE];
+    if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) ||
+        memcmp(magic, TASK_RECORD_MAGIC, sizeof(magic)))
+    {
+        SWSS_LOG_ERROR("%s is not a task record file\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool TaskRecordReader::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(m_file);
+        if (c == EOF)
+            return false;
+
+        value |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool TaskRecordReader::readString(string &value)
+{
+    uint64_t size;
+    if (!readVarint(size) || size > TASK_RECORD_BUFFER_SIZE * 16)
+        return false;
+
+    value.resize(size);
+    return !size || fread(&value[0], 1, size, m_file) == size;
+}
+
+bool TaskRecordReader::next(TaskRecord &record)
+{
+    if (!m_file)
+        return false;
+
+    while (true)
+    {
+        int type = fgetc(m_file);
+        if (type == EOF)
+            return false;
+
+        uint64_t value;
+        if (!readVarint(value))
+            break;
+
+        if (type == TASK_RECORD_SEGMENT)
+        {
+            m_last = value;
+            m_newSegment = true;
+            continue;
+        }
+
+        if (type != TASK_RECORD_TASK)
+            break;
+
+        m_last += value;
+        record.time = m_last;
+        record.newSegment = m_newSegment;
+        m_newSegment = false;
+
+        string key, op;
+        uint64_t count;
+        if (!readString(record.table) || !readString(key) || !readString(op) || !readVarint(count))
+            break;
+
+        vector<FieldValueTuple> fvs;
+        string field, val;
+        while (fvs.size() < count && readString(field) && readString(val))
+            fvs.push_back(FieldValueTuple(field, val));
+        if (fvs.size() < count)
+            break;
+
+        record.entry = KeyOpFieldsValuesTuple(key, op, fvs);
+        return true;
+    }
+
+    SWSS_LOG_WARN("Truncated or corrupt task record at offset %ld\n", ftell(m_file));
+    return false;
+}
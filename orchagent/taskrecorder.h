@@ -0,0 +1,77 @@
+#ifndef SWSS_TASKRECORDER_H
+#define SWSS_TASKRECORDER_H
+
+#include "table.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+using namespace swss;
+
+/*
+ * Recording of the entries popped from the consumer tables, in an
+ * append-only binary file:
+ *
+ *   file    := TASK_RECORD_MAGIC record*
+ *   record  := 'S' varint(unix time, ns)                          start of a run
+ *            | 'T' varint(ns since previous record) string(table)
+ *                  string(key) string(op) varint(n) (string(field) string(value))^n
+ *   string  := varint(length) bytes
+ *
+ * varints are LEB128. Every orchagent run appends a new 'S' record, so that a
+ * file survives restarts; the time between two runs is not replayed.
+ */
+#define TASK_RECORD_MAGIC       "SWSSREC1"
+#define TASK_RECORD_MAGIC_SIZE  8
+#define TASK_RECORD_SEGMENT     'S'
+#define TASK_RECORD_TASK        'T'
+/* Buffered bytes written out without waiting for a flush() */
+#define TASK_RECORD_BUFFER_SIZE (64 * 1024)
+
+class TaskRecorder
+{
+public:
+    static bool open(const string &path);
+    static bool isEnabled() { return m_fd >= 0; }
+
+    /* Append an entry popped from table, before it is merged into m_toSync */
+    static void record(const string &table, const KeyOpFieldsValuesTuple &entry);
+    /* Write the buffered records to the file */
+    static void flush();
+
+private:
+    static int m_fd;
+    static string m_buffer;
+    static uint64_t m_last;
+};
+
+struct TaskRecord
+{
+    uint64_t                time;       // unix time (ns)
+    bool                    newSegment; // first record of a run
+    string                  table;
+    KeyOpFieldsValuesTuple  entry;
+};
+
+class TaskRecordReader
+{
+public:
+    TaskRecordReader();
+    ~TaskRecordReader();
+
+    bool open(const string &path);
+    /* Read the next entry, false at the end of the file or on a corrupt record */
+    bool next(TaskRecord &record);
+
+private:
+    FILE *m_file;
+    uint64_t m_last;
+    bool m_newSegment;
+
+    bool readVarint(uint64_t &value);
+    bool readString(string &value);
+};
+
+#endif /* SWSS_TASKRECORDER_H */
@@ -0,0 +1,43 @@
+#ifndef SWSS_TRACEEVENTS_H
+#define SWSS_TRACEEVENTS_H
+
+#include "common/tracering.h"
+
+/* Trace ring of orchagent, decoded by orchtrace */
+#define TRACE_RING_PATH         "/dev/shm/orchagent.trace"
+#define TRACE_RING_CAPACITY     65536
+
+/*
+ * Events recorded in the trace ring: id, name and one name:type per
+ * argument, where type is one of
+ *   ip4     IPv4 address as stored by SAI (network byte order)
+ *   oid     SAI object id
+ *   status  sai_status_t
+ *   int     unsigned integer
+ */
+#define ORCH_TRACE_EVENTS(X) \
+    X(TRACE_ROUTE_CREATE,       "route_create",     "dst:ip4 mask:ip4 nh:oid status:status") \
+    X(TRACE_ROUTE_SET,          "route_set",        "dst:ip4 mask:ip4 nh:oid status:status") \
+    X(TRACE_ROUTE_REMOVE,       "route_remove",     "dst:ip4 mask:ip4 status:status") \
+    X(TRACE_ROUTE_NO_NEXT_HOP,  "route_no_next_hop", "dst:ip4 mask:ip4 nh:ip4") \
+    X(TRACE_NHG_CREATE,         "nhg_create",       "nhg:oid members:int status:status") \
+    X(TRACE_NHG_REMOVE,         "nhg_remove",       "nhg:oid status:status") \
+    X(TRACE_NHG_FULL,           "nhg_full",         "groups:int") \
+    X(TRACE_NHG_NO_NEXT_HOP,    "nhg_no_next_hop",  "nh:ip4") \
+    X(TRACE_NHG_MEMBER_REMOVE,  "nhg_member_remove", "nhg:oid nh:oid status:status") \
+    X(TRACE_NHG_MEMBER_ADD,     "nhg_member_add",   "nhg:oid nh:oid status:status") \
+    X(TRACE_NEIGHBOR_CREATE,    "neighbor_create",  "ip:ip4 rif:oid status:status") \
+    X(TRACE_NEIGHBOR_REMOVE,    "neighbor_remove",  "ip:ip4 rif:oid status:status") \
+    X(TRACE_NEXT_HOP_CREATE,    "next_hop_create",  "ip:ip4 rif:oid nh:oid status:status") \
+    X(TRACE_NEXT_HOP_REMOVE,    "next_hop_remove",  "nh:oid status:status")
+
+#define ORCH_TRACE_ID(id, name, args) id,
+enum OrchTraceEvent
+{
+    TRACE_NONE = 0,
+    ORCH_TRACE_EVENTS(ORCH_TRACE_ID)
+    TRACE_EVENT_MAX
+};
+#undef ORCH_TRACE_ID
+
+#endif /* SWSS_TRACEEVENTS_H */
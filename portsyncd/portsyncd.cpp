@@ -1,5 +1,5 @@
 #include "dbconnector.h"
-#include "select.h"
+#include "common/epollselect.h"
 #include "netdispatcher.h"
 #include "netlink.h"
 #include "producertable.h"
@@ -81,7 +81,7 @@ int main(int argc, char **argv)
     try
     {
         NetLink netlink;
-        Select s;
+        EpollSelect s;
 
         netlink.registerGroup(RTNLGRP_LINK);
         cout << "Listen to link messages..." << endl;
@@ -92,17 +92,17 @@ int main(int argc, char **argv)
         s.addSelectable(&netlink);
         while (true)
         {
-            Selectable *temps;
-            int tempfd, ret;
-            ret = s.select(&temps, &tempfd, 1);
+            vector<Selectable *> ready;
+            int ret;
+            ret = s.select(ready, 1);
 
-            if (ret == Select::ERROR)
+            if (ret == EpollSelect::ERROR)
             {
                 cerr << "Error had been returned in select" << endl;
                 continue;
             }
 
-            if (ret == Select::TIMEOUT)
+            if (ret == EpollSelect::TIMEOUT)
             {
                 if (!g_init && g_portSet.empty())
                 {
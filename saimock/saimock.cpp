@@ -0,0 +1,1182 @@
+#include "saimock/saimock.h"
+
+#include "logger.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+#define DEFAULT_PORT_COUNT  32
+#define DEFAULT_VLAN_ID     1
+#define LANES_PER_PORT      4
+/* Below this latency the calls spin instead of sleeping (us) */
+#define SPIN_LATENCY_MAX    100
+
+enum MockObjectType
+{
+    MOCK_OBJECT_PORT = 1,
+    MOCK_OBJECT_VIRTUAL_ROUTER,
+    MOCK_OBJECT_VLAN_MEMBER,
+    MOCK_OBJECT_ROUTER_INTERFACE,
+    MOCK_OBJECT_HOSTIF,
+    MOCK_OBJECT_NEXT_HOP,
+    MOCK_OBJECT_NEXT_HOP_GROUP,
+    MOCK_OBJECT_LAG,
+    MOCK_OBJECT_LAG_MEMBER,
+};
+
+/* vr_id, address family, address, mask */
+typedef tuple<sai_object_id_t, int, string, string> RouteKey;
+/* rif_id, address family, address */
+typedef tuple<sai_object_id_t, int, string> NeighborKey;
+
+struct MockObject
+{
+    MockObjectType              type;
+    vector<sai_attribute_t>     attrs;      // scalar attributes, lists are not kept
+    vector<sai_object_id_t>     members;    // next hops of a group, ports of a VLAN
+};
+
+struct MockState
+{
+    bool                        initialized;
+    uint32_t                    port_count;
+    uint32_t                    latency[SAI_API_MAX];
+    double                      failure_rate[SAI_API_MAX];
+    uint32_t                    limits[SAIMOCK_LIMIT_MAX];
+    unsigned int                seed;
+
+    uint64_t                    next_index;
+    map<sai_object_id_t, MockObject> objects;
+    /* Number of objects and routes referring to an object */
+    map<sai_object_id_t, int>   refs;
+
+    vector<sai_object_id_t>     ports;
+    sai_object_id_t             cpu_port;
+    sai_object_id_t             default_vr_id;
+    sai_mac_t                   mac;
+    set<sai_vlan_id_t>          vlans;
+
+    map<RouteKey, sai_object_id_t>  routes;     // next hop id, or 0
+    map<NeighborKey, MockObject>    neighbors;
+    uint32_t                    next_hop_count;
+    uint32_t                    next_hop_group_count;
+};
+
+static MockState g_state;
+
+static const char *api_names[SAI_API_MAX] = { };
+
+static void initApiNames()
+{
+    api_names[SAI_API_SWITCH]           = "switch";
+    api_names[SAI_API_PORT]             = "port";
+    api_names[SAI_API_VLAN]             = "vlan";
+    api_names[SAI_API_VIRTUAL_ROUTER]   = "virtual_router";
+    api_names[SAI_API_ROUTE]            = "route";
+    api_names[SAI_API_NEXT_HOP]         = "next_hop";
+    api_names[SAI_API_NEXT_HOP_GROUP]   = "next_hop_group";
+    api_names[SAI_API_ROUTER_INTERFACE] = "router_interface";
+    api_names[SAI_API_NEIGHBOR]         = "neighbor";
+    api_names[SAI_API_HOST_INTERFACE]   = "host_interface";
+    api_names[SAI_API_LAG]              = "lag";
+}
+
+/* Wait for the configured latency of a call */
+static void mockWait(sai_api_t api)
+{
+    uint32_t latency = g_state.latency[api];
+    if (latency > SPIN_LATENCY_MAX)
+    {
+        this_thread::sleep_for(chrono::microseconds(latency));
+    }
+    else if (latency)
+    {
+        auto end = chrono::steady_clock::now() + chrono::microseconds(latency);
+        while (chrono::steady_clock::now() < end);
+    }
+}
+
+/* Decide whether a call, or an entry of a bulk call, fails */
+static sai_status_t mockFail(sai_api_t api)
+{
+    double rate = g_state.failure_rate[api];
+    if (rate > 0 && (double)rand_r(&g_state.seed) / RAND_MAX < rate)
+        return SAI_STATUS_FAILURE;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Common prologue of every call */
+static sai_status_t mockEnter(sai_api_t api)
+{
+    mockWait(api);
+    return mockFail(api);
+}
+
+#define MOCK_ENTER(api)                             \
+    do {                                            \
+        sai_status_t _status = mockEnter(api);      \
+        if (_status != SAI_STATUS_SUCCESS)          \
+            return _status;                         \
+    } while (0)
+
+static sai_object_id_t createObject(MockObjectType type, uint32_t attr_count,
+                                    const sai_attribute_t *attr_list)
+{
+    sai_object_id_t id = ((sai_object_id_t)type << 48) | ++g_state.next_index;
+    MockObject &object = g_state.objects[id];
+
+    object.type = type;
+    if (attr_count)
+        object.attrs.assign(attr_list, attr_list + attr_count);
+    return id;
+}
+
+static bool hasObject(sai_object_id_t id, MockObjectType type)
+{
+    auto it = g_state.objects.find(id);
+    return it != g_state.objects.end() && it->second.type == type;
+}
+
+static sai_status_t removeObject(sai_object_id_t id, MockObjectType type)
+{
+    if (!hasObject(id, type))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    auto ref = g_state.refs.find(id);
+    if (ref != g_state.refs.end() && ref->second > 0)
+        return SAI_STATUS_OBJECT_IN_USE;
+
+    g_state.objects.erase(id);
+    g_state.refs.erase(id);
+    return SAI_STATUS_SUCCESS;
+}
+
+static const sai_attribute_t *findAttribute(uint32_t id, uint32_t attr_count,
+                                            const sai_attribute_t *attr_list)
+{
+    for (uint32_t i = 0; i < attr_count; i++)
+    {
+        if (attr_list[i].id == id)
+            return &attr_list[i];
+    }
+    return NULL;
+}
+
+static bool isFull(saimock_limit_t limit, uint32_t count)
+{
+    return g_state.limits[limit] && count >= g_state.limits[limit];
+}
+
+static string ipBytes(sai_ip_addr_family_t family, const sai_ip4_t &ip4, const sai_ip6_t &ip6)
+{
+    if (family == SAI_IP_ADDR_FAMILY_IPV4)
+        return string((const char *)&ip4, sizeof(ip4));
+    return string((const char *)ip6, sizeof(sai_ip6_t));
+}
+
+static RouteKey getRouteKey(const sai_unicast_route_entry_t *entry)
+{
+    const sai_ip_prefix_t &p = entry->destination;
+
+    if (p.addr_family == SAI_IP_ADDR_FAMILY_IPV4)
+    {
+        sai_ip4_t ip4 = p.addr.ip4 & p.mask.ip4;
+        return RouteKey(entry->vr_id, p.addr_family,
+                        string((const char *)&ip4, sizeof(ip4)),
+                        string((const char *)&p.mask.ip4, sizeof(p.mask.ip4)));
+    }
+
+    return RouteKey(entry->vr_id, p.addr_family,
+                    string((const char *)p.addr.ip6, sizeof(sai_ip6_t)),
+                    string((const char *)p.mask.ip6, sizeof(sai_ip6_t)));
+}
+
+static NeighborKey getNeighborKey(const sai_neighbor_entry_t *entry)
+{
+    const sai_ip_address_t &ip = entry->ip_address;
+    return NeighborKey(entry->rif_id, ip.addr_family, ipBytes(ip.addr_family, ip.addr.ip4, ip.addr.ip6));
+}
+
+/* Switch API */
+
+static sai_status_t mock_initialize_switch(sai_switch_profile_id_t profile_id,
+                                           char *switch_hardware_id,
+                                           char *microcode_module_name,
+                                           sai_switch_notification_t *switch_notifications)
+{
+    MOCK_ENTER(SAI_API_SWITCH);
+
+    if (g_state.initialized)
+        return SAI_STATUS_SUCCESS;
+
+    g_state.cpu_port = createObject(MOCK_OBJECT_PORT, 0, NULL);
+    g_state.default_vr_id = createObject(MOCK_OBJECT_VIRTUAL_ROUTER, 0, NULL);
+    g_state.vlans.insert(DEFAULT_VLAN_ID);
+
+    /* Every port starts as a member of the default VLAN */
+    for (uint32_t i = 0; i < g_state.port_count; i++)
+    {
+        sai_object_id_t port_id = createObject(MOCK_OBJECT_PORT, 0, NULL);
+        g_state.ports.push_back(port_id);
+
+        sai_attribute_t attrs[2];
+        attrs[0].id = SAI_VLAN_MEMBER_ATTR_VLAN_ID;
+        attrs[0].value.u16 = DEFAULT_VLAN_ID;
+        attrs[1].id = SAI_VLAN_MEMBER_ATTR_PORT_ID;
+        attrs[1].value.oid = port_id;
+        createObject(MOCK_OBJECT_VLAN_MEMBER, 2, attrs);
+        g_state.refs[port_id]++;
+    }
+
+    g_state.initialized = true;
+    SWSS_LOG_NOTICE("saimock: initialized switch with %u ports\n", g_state.port_count);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static void mock_shutdown_switch(bool warm_restart_hint)
+{
+}
+
+static sai_status_t mock_connect_switch(sai_switch_profile_id_t profile_id,
+                                        char *switch_hardware_id,
+                                        sai_switch_notification_t *switch_notifications)
+{
+    return mock_initialize_switch(profile_id, switch_hardware_id, NULL, switch_notifications);
+}
+
+static void mock_disconnect_switch(void)
+{
+}
+
+static sai_status_t mock_set_switch_attribute(const sai_attribute_t *attr)
+{
+    MOCK_ENTER(SAI_API_SWITCH);
+
+    if (attr->id == SAI_SWITCH_ATTR_SRC_MAC_ADDRESS)
+        memcpy(g_state.mac, attr->value.mac, sizeof(sai_mac_t));
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_get_switch_attribute(uint32_t attr_count, sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_SWITCH);
+
+    for (uint32_t i = 0; i < attr_count; i++)
+    {
+        sai_attribute_t &attr = attr_list[i];
+
+        switch (attr.id)
+        {
+        case SAI_SWITCH_ATTR_PORT_NUMBER:
+            attr.value.u32 = (uint32_t)g_state.ports.size();
+            break;
+        case SAI_SWITCH_ATTR_PORT_LIST:
+        {
+            uint32_t count = min<uint32_t>(attr.value.objlist.count, (uint32_t)g_state.ports.size());
+            for (uint32_t j = 0; j < count; j++)
+                attr.value.objlist.list[j] = g_state.ports[j];
+            attr.value.objlist.count = count;
+            break;
+        }
+        case SAI_SWITCH_ATTR_CPU_PORT:
+            attr.value.oid = g_state.cpu_port;
+            break;
+        case SAI_SWITCH_ATTR_SRC_MAC_ADDRESS:
+            memcpy(attr.value.mac, g_state.mac, sizeof(sai_mac_t));
+            break;
+        case SAI_SWITCH_ATTR_DEFAULT_VIRTUAL_ROUTER_ID:
+            attr.value.oid = g_state.default_vr_id;
+            break;
+        default:
+            return SAI_STATUS_NOT_SUPPORTED;
+        }
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Port API */
+
+static sai_status_t mock_set_port_attribute(sai_object_id_t port_id, const sai_attribute_t *attr)
+{
+    MOCK_ENTER(SAI_API_PORT);
+
+    if (!hasObject(port_id, MOCK_OBJECT_PORT))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_get_port_attribute(sai_object_id_t port_id, uint32_t attr_count,
+                                            sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_PORT);
+
+    uint32_t index = 0;
+    while (index < g_state.ports.size() && g_state.ports[index] != port_id)
+        index++;
+    if (index == g_state.ports.size())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    for (uint32_t i = 0; i < attr_count; i++)
+    {
+        sai_attribute_t &attr = attr_list[i];
+
+        if (attr.id != SAI_PORT_ATTR_HW_LANE_LIST)
+            return SAI_STATUS_NOT_SUPPORTED;
+
+        uint32_t count = min<uint32_t>(attr.value.u32list.count, LANES_PER_PORT);
+        for (uint32_t j = 0; j < count; j++)
+            attr.value.u32list.list[j] = index * LANES_PER_PORT + j;
+        attr.value.u32list.count = count;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* VLAN API */
+
+static sai_status_t mock_create_vlan(sai_vlan_id_t vlan_id)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    if (!g_state.vlans.insert(vlan_id).second)
+        return SAI_STATUS_ITEM_ALREADY_EXISTS;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_vlan(sai_vlan_id_t vlan_id)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    if (!g_state.vlans.erase(vlan_id))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_set_vlan_attribute(sai_vlan_id_t vlan_id, const sai_attribute_t *attr)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    if (g_state.vlans.find(vlan_id) == g_state.vlans.end())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_get_vlan_attribute(sai_vlan_id_t vlan_id, uint32_t attr_count,
+                                            sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    if (g_state.vlans.find(vlan_id) == g_state.vlans.end())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    for (uint32_t i = 0; i < attr_count; i++)
+    {
+        sai_attribute_t &attr = attr_list[i];
+
+        if (attr.id != SAI_VLAN_ATTR_MEMBER_LIST)
+            return SAI_STATUS_NOT_SUPPORTED;
+
+        uint32_t count = 0;
+        for (auto &it : g_state.objects)
+        {
+            if (it.second.type != MOCK_OBJECT_VLAN_MEMBER)
+                continue;
+
+            const MockObject &member = it.second;
+            const sai_attribute_t *vid = findAttribute(SAI_VLAN_MEMBER_ATTR_VLAN_ID,
+                    (uint32_t)member.attrs.size(), member.attrs.data());
+            if (!vid || vid->value.u16 != vlan_id)
+                continue;
+
+            if (count < attr.value.objlist.count)
+                attr.value.objlist.list[count] = it.first;
+            count++;
+        }
+
+        if (count > attr.value.objlist.count)
+            return SAI_STATUS_BUFFER_OVERFLOW;
+        attr.value.objlist.count = count;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_create_vlan_member(sai_object_id_t *vlan_member_id, uint32_t attr_count,
+                                            const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    const sai_attribute_t *vid = findAttribute(SAI_VLAN_MEMBER_ATTR_VLAN_ID, attr_count, attr_list);
+    const sai_attribute_t *port = findAttribute(SAI_VLAN_MEMBER_ATTR_PORT_ID, attr_count, attr_list);
+    if (!vid || !port)
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    if (g_state.vlans.find(vid->value.u16) == g_state.vlans.end() ||
+        !(hasObject(port->value.oid, MOCK_OBJECT_PORT) || hasObject(port->value.oid, MOCK_OBJECT_LAG)))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    *vlan_member_id = createObject(MOCK_OBJECT_VLAN_MEMBER, attr_count, attr_list);
+    g_state.refs[port->value.oid]++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_vlan_member(sai_object_id_t vlan_member_id)
+{
+    MOCK_ENTER(SAI_API_VLAN);
+
+    if (!hasObject(vlan_member_id, MOCK_OBJECT_VLAN_MEMBER))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    const MockObject &member = g_state.objects[vlan_member_id];
+    const sai_attribute_t *port = findAttribute(SAI_VLAN_MEMBER_ATTR_PORT_ID,
+            (uint32_t)member.attrs.size(), member.attrs.data());
+    if (port)
+        g_state.refs[port->value.oid]--;
+
+    return removeObject(vlan_member_id, MOCK_OBJECT_VLAN_MEMBER);
+}
+
+/* Virtual router API */
+
+static sai_status_t mock_create_virtual_router(sai_object_id_t *vr_id, uint32_t attr_count,
+                                               const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_VIRTUAL_ROUTER);
+
+    *vr_id = createObject(MOCK_OBJECT_VIRTUAL_ROUTER, attr_count, attr_list);
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_virtual_router(sai_object_id_t vr_id)
+{
+    MOCK_ENTER(SAI_API_VIRTUAL_ROUTER);
+
+    if (vr_id == g_state.default_vr_id)
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    return removeObject(vr_id, MOCK_OBJECT_VIRTUAL_ROUTER);
+}
+
+/* Router interface API */
+
+static sai_status_t mock_create_router_interface(sai_object_id_t *rif_id, uint32_t attr_count,
+                                                 const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_ROUTER_INTERFACE);
+
+    const sai_attribute_t *vr = findAttribute(SAI_ROUTER_INTERFACE_ATTR_VIRTUAL_ROUTER_ID, attr_count, attr_list);
+    if (!vr || !hasObject(vr->value.oid, MOCK_OBJECT_VIRTUAL_ROUTER))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    const sai_attribute_t *port = findAttribute(SAI_ROUTER_INTERFACE_ATTR_PORT_ID, attr_count, attr_list);
+    if (port)
+    {
+        if (!hasObject(port->value.oid, MOCK_OBJECT_PORT) && !hasObject(port->value.oid, MOCK_OBJECT_LAG))
+            return SAI_STATUS_INVALID_PARAMETER;
+        g_state.refs[port->value.oid]++;
+    }
+
+    *rif_id = createObject(MOCK_OBJECT_ROUTER_INTERFACE, attr_count, attr_list);
+    g_state.refs[vr->value.oid]++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_router_interface(sai_object_id_t rif_id)
+{
+    MOCK_ENTER(SAI_API_ROUTER_INTERFACE);
+
+    if (!hasObject(rif_id, MOCK_OBJECT_ROUTER_INTERFACE))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    vector<sai_attribute_t> attrs = g_state.objects[rif_id].attrs;
+    sai_status_t status = removeObject(rif_id, MOCK_OBJECT_ROUTER_INTERFACE);
+    if (status != SAI_STATUS_SUCCESS)
+        return status;
+
+    for (auto &attr : attrs)
+    {
+        if (attr.id == SAI_ROUTER_INTERFACE_ATTR_VIRTUAL_ROUTER_ID ||
+            attr.id == SAI_ROUTER_INTERFACE_ATTR_PORT_ID)
+            g_state.refs[attr.value.oid]--;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Host interface API */
+
+static sai_status_t mock_create_hostif(sai_object_id_t *hif_id, uint32_t attr_count,
+                                       const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_HOST_INTERFACE);
+
+    *hif_id = createObject(MOCK_OBJECT_HOSTIF, attr_count, attr_list);
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_hostif(sai_object_id_t hif_id)
+{
+    MOCK_ENTER(SAI_API_HOST_INTERFACE);
+
+    return removeObject(hif_id, MOCK_OBJECT_HOSTIF);
+}
+
+static sai_status_t mock_set_trap_attribute(sai_hostif_trap_id_t hostif_trapid, const sai_attribute_t *attr)
+{
+    MOCK_ENTER(SAI_API_HOST_INTERFACE);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Neighbor API */
+
+static sai_status_t mock_create_neighbor_entry(const sai_neighbor_entry_t *neighbor_entry,
+                                               uint32_t attr_count, const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_NEIGHBOR);
+
+    if (!hasObject(neighbor_entry->rif_id, MOCK_OBJECT_ROUTER_INTERFACE))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    NeighborKey key = getNeighborKey(neighbor_entry);
+    if (g_state.neighbors.find(key) != g_state.neighbors.end())
+        return SAI_STATUS_ITEM_ALREADY_EXISTS;
+
+    if (isFull(SAIMOCK_LIMIT_NEIGHBORS, (uint32_t)g_state.neighbors.size()))
+        return SAI_STATUS_TABLE_FULL;
+
+    MockObject &neighbor = g_state.neighbors[key];
+    if (attr_count)
+        neighbor.attrs.assign(attr_list, attr_list + attr_count);
+    g_state.refs[neighbor_entry->rif_id]++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_neighbor_entry(const sai_neighbor_entry_t *neighbor_entry)
+{
+    MOCK_ENTER(SAI_API_NEIGHBOR);
+
+    if (!g_state.neighbors.erase(getNeighborKey(neighbor_entry)))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    g_state.refs[neighbor_entry->rif_id]--;
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Next hop API */
+
+static sai_status_t mock_create_next_hop(sai_object_id_t *next_hop_id, uint32_t attr_count,
+                                         const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP);
+
+    const sai_attribute_t *rif = findAttribute(SAI_NEXT_HOP_ATTR_ROUTER_INTERFACE_ID, attr_count, attr_list);
+    if (!rif || !hasObject(rif->value.oid, MOCK_OBJECT_ROUTER_INTERFACE))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    if (isFull(SAIMOCK_LIMIT_NEXT_HOPS, g_state.next_hop_count))
+        return SAI_STATUS_TABLE_FULL;
+
+    *next_hop_id = createObject(MOCK_OBJECT_NEXT_HOP, attr_count, attr_list);
+    g_state.refs[rif->value.oid]++;
+    g_state.next_hop_count++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_next_hop(sai_object_id_t next_hop_id)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP);
+
+    if (!hasObject(next_hop_id, MOCK_OBJECT_NEXT_HOP))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    const MockObject &next_hop = g_state.objects[next_hop_id];
+    const sai_attribute_t *rif = findAttribute(SAI_NEXT_HOP_ATTR_ROUTER_INTERFACE_ID,
+            (uint32_t)next_hop.attrs.size(), next_hop.attrs.data());
+    sai_object_id_t rif_id = rif->value.oid;
+
+    sai_status_t status = removeObject(next_hop_id, MOCK_OBJECT_NEXT_HOP);
+    if (status != SAI_STATUS_SUCCESS)
+        return status;
+
+    g_state.refs[rif_id]--;
+    g_state.next_hop_count--;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Next hop group API */
+
+static sai_status_t mock_create_next_hop_group(sai_object_id_t *next_hop_group_id, uint32_t attr_count,
+                                               const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP_GROUP);
+
+    const sai_attribute_t *list = findAttribute(SAI_NEXT_HOP_GROUP_ATTR_NEXT_HOP_LIST, attr_count, attr_list);
+    if (!list)
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    for (uint32_t i = 0; i < list->value.objlist.count; i++)
+    {
+        if (!hasObject(list->value.objlist.list[i], MOCK_OBJECT_NEXT_HOP))
+            return SAI_STATUS_INVALID_PARAMETER;
+    }
+
+    if (isFull(SAIMOCK_LIMIT_NEXT_HOP_GROUPS, g_state.next_hop_group_count))
+        return SAI_STATUS_TABLE_FULL;
+
+    *next_hop_group_id = createObject(MOCK_OBJECT_NEXT_HOP_GROUP, 0, NULL);
+    MockObject &group = g_state.objects[*next_hop_group_id];
+    group.members.assign(list->value.objlist.list, list->value.objlist.list + list->value.objlist.count);
+    for (auto id : group.members)
+        g_state.refs[id]++;
+    g_state.next_hop_group_count++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_next_hop_group(sai_object_id_t next_hop_group_id)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP_GROUP);
+
+    if (!hasObject(next_hop_group_id, MOCK_OBJECT_NEXT_HOP_GROUP))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    vector<sai_object_id_t> members = g_state.objects[next_hop_group_id].members;
+    sai_status_t status = removeObject(next_hop_group_id, MOCK_OBJECT_NEXT_HOP_GROUP);
+    if (status != SAI_STATUS_SUCCESS)
+        return status;
+
+    for (auto id : members)
+        g_state.refs[id]--;
+    g_state.next_hop_group_count--;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_add_next_hop_to_group(sai_object_id_t next_hop_group_id,
+                                               uint32_t next_hop_count,
+                                               const sai_object_id_t *nexthops)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP_GROUP);
+
+    if (!hasObject(next_hop_group_id, MOCK_OBJECT_NEXT_HOP_GROUP))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    for (uint32_t i = 0; i < next_hop_count; i++)
+    {
+        if (!hasObject(nexthops[i], MOCK_OBJECT_NEXT_HOP))
+            return SAI_STATUS_INVALID_PARAMETER;
+    }
+
+    MockObject &group = g_state.objects[next_hop_group_id];
+    for (uint32_t i = 0; i < next_hop_count; i++)
+    {
+        group.members.push_back(nexthops[i]);
+        g_state.refs[nexthops[i]]++;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_next_hop_from_group(sai_object_id_t next_hop_group_id,
+                                                    uint32_t next_hop_count,
+                                                    const sai_object_id_t *nexthops)
+{
+    MOCK_ENTER(SAI_API_NEXT_HOP_GROUP);
+
+    if (!hasObject(next_hop_group_id, MOCK_OBJECT_NEXT_HOP_GROUP))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    MockObject &group = g_state.objects[next_hop_group_id];
+    for (uint32_t i = 0; i < next_hop_count; i++)
+    {
+        auto it = find(group.members.begin(), group.members.end(), nexthops[i]);
+        if (it == group.members.end())
+            return SAI_STATUS_ITEM_NOT_FOUND;
+
+        group.members.erase(it);
+        g_state.refs[nexthops[i]]--;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Route API */
+
+static sai_status_t createRoute(const sai_unicast_route_entry_t *unicast_route_entry,
+                                uint32_t attr_count, const sai_attribute_t *attr_list)
+{
+    if (!hasObject(unicast_route_entry->vr_id, MOCK_OBJECT_VIRTUAL_ROUTER))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    RouteKey key = getRouteKey(unicast_route_entry);
+    if (g_state.routes.find(key) != g_state.routes.end())
+        return SAI_STATUS_ITEM_ALREADY_EXISTS;
+
+    if (isFull(SAIMOCK_LIMIT_ROUTES, (uint32_t)g_state.routes.size()))
+        return SAI_STATUS_TABLE_FULL;
+
+    sai_object_id_t next_hop_id = 0;
+    const sai_attribute_t *nh = findAttribute(SAI_ROUTE_ATTR_NEXT_HOP_ID, attr_count, attr_list);
+    if (nh)
+    {
+        if (g_state.objects.find(nh->value.oid) == g_state.objects.end())
+            return SAI_STATUS_INVALID_PARAMETER;
+
+        next_hop_id = nh->value.oid;
+        g_state.refs[next_hop_id]++;
+    }
+
+    g_state.routes[key] = next_hop_id;
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t removeRoute(const sai_unicast_route_entry_t *unicast_route_entry)
+{
+    auto it = g_state.routes.find(getRouteKey(unicast_route_entry));
+    if (it == g_state.routes.end())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    if (it->second)
+        g_state.refs[it->second]--;
+    g_state.routes.erase(it);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t setRouteAttribute(const sai_unicast_route_entry_t *unicast_route_entry,
+                                      const sai_attribute_t *attr)
+{
+    auto it = g_state.routes.find(getRouteKey(unicast_route_entry));
+    if (it == g_state.routes.end())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    if (attr->id == SAI_ROUTE_ATTR_NEXT_HOP_ID)
+    {
+        if (g_state.objects.find(attr->value.oid) == g_state.objects.end())
+            return SAI_STATUS_INVALID_PARAMETER;
+
+        if (it->second)
+            g_state.refs[it->second]--;
+        it->second = attr->value.oid;
+        g_state.refs[it->second]++;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_create_route(const sai_unicast_route_entry_t *unicast_route_entry,
+                                      uint32_t attr_count, const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_ROUTE);
+
+    return createRoute(unicast_route_entry, attr_count, attr_list);
+}
+
+static sai_status_t mock_remove_route(const sai_unicast_route_entry_t *unicast_route_entry)
+{
+    MOCK_ENTER(SAI_API_ROUTE);
+
+    return removeRoute(unicast_route_entry);
+}
+
+static sai_status_t mock_set_route_attribute(const sai_unicast_route_entry_t *unicast_route_entry,
+                                             const sai_attribute_t *attr)
+{
+    MOCK_ENTER(SAI_API_ROUTE);
+
+    return setRouteAttribute(unicast_route_entry, attr);
+}
+
+static sai_status_t mock_get_route_attribute(const sai_unicast_route_entry_t *unicast_route_entry,
+                                             uint32_t attr_count, sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_ROUTE);
+
+    auto it = g_state.routes.find(getRouteKey(unicast_route_entry));
+    if (it == g_state.routes.end())
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    for (uint32_t i = 0; i < attr_count; i++)
+    {
+        if (attr_list[i].id != SAI_ROUTE_ATTR_NEXT_HOP_ID)
+            return SAI_STATUS_NOT_SUPPORTED;
+        attr_list[i].value.oid = it->second;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+/* Bulk route API: the latency is paid once per call, failures are drawn per entry */
+
+static sai_status_t mock_create_routes(uint32_t object_count,
+                                       const sai_unicast_route_entry_t *route_entry,
+                                       const uint32_t *attr_count,
+                                       const sai_attribute_t **attr_list,
+                                       sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    mockWait(SAI_API_ROUTE);
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = mockFail(SAI_API_ROUTE);
+        if (object_statuses[i] == SAI_STATUS_SUCCESS)
+            object_statuses[i] = createRoute(&route_entry[i], attr_count[i], attr_list[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+static sai_status_t mock_remove_routes(uint32_t object_count,
+                                       const sai_unicast_route_entry_t *route_entry,
+                                       sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    mockWait(SAI_API_ROUTE);
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = mockFail(SAI_API_ROUTE);
+        if (object_statuses[i] == SAI_STATUS_SUCCESS)
+            object_statuses[i] = removeRoute(&route_entry[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+static sai_status_t mock_set_routes_attribute(uint32_t object_count,
+                                              const sai_unicast_route_entry_t *route_entry,
+                                              const sai_attribute_t *attr_list,
+                                              sai_status_t *object_statuses)
+{
+    sai_status_t status = SAI_STATUS_SUCCESS;
+
+    mockWait(SAI_API_ROUTE);
+    for (uint32_t i = 0; i < object_count; i++)
+    {
+        object_statuses[i] = mockFail(SAI_API_ROUTE);
+        if (object_statuses[i] == SAI_STATUS_SUCCESS)
+            object_statuses[i] = setRouteAttribute(&route_entry[i], &attr_list[i]);
+        if (object_statuses[i] != SAI_STATUS_SUCCESS)
+            status = SAI_STATUS_FAILURE;
+    }
+
+    return status;
+}
+
+/* LAG API */
+
+static sai_status_t mock_create_lag(sai_object_id_t *lag_id, uint32_t attr_count,
+                                    sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_LAG);
+
+    *lag_id = createObject(MOCK_OBJECT_LAG, attr_count, attr_list);
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_lag(sai_object_id_t lag_id)
+{
+    MOCK_ENTER(SAI_API_LAG);
+
+    return removeObject(lag_id, MOCK_OBJECT_LAG);
+}
+
+static sai_status_t mock_create_lag_member(sai_object_id_t *lag_member_id, uint32_t attr_count,
+                                           const sai_attribute_t *attr_list)
+{
+    MOCK_ENTER(SAI_API_LAG);
+
+    const sai_attribute_t *lag = findAttribute(SAI_LAG_MEMBER_ATTR_LAG_ID, attr_count, attr_list);
+    const sai_attribute_t *port = findAttribute(SAI_LAG_MEMBER_ATTR_PORT_ID, attr_count, attr_list);
+    if (!lag || !port ||
+        !hasObject(lag->value.oid, MOCK_OBJECT_LAG) ||
+        !hasObject(port->value.oid, MOCK_OBJECT_PORT))
+        return SAI_STATUS_INVALID_PARAMETER;
+
+    *lag_member_id = createObject(MOCK_OBJECT_LAG_MEMBER, attr_count, attr_list);
+    g_state.refs[lag->value.oid]++;
+    g_state.refs[port->value.oid]++;
+
+    return SAI_STATUS_SUCCESS;
+}
+
+static sai_status_t mock_remove_lag_member(sai_object_id_t lag_member_id)
+{
+    MOCK_ENTER(SAI_API_LAG);
+
+    if (!hasObject(lag_member_id, MOCK_OBJECT_LAG_MEMBER))
+        return SAI_STATUS_ITEM_NOT_FOUND;
+
+    for (auto &attr : g_state.objects[lag_member_id].attrs)
+    {
+        if (attr.id == SAI_LAG_MEMBER_ATTR_LAG_ID || attr.id == SAI_LAG_MEMBER_ATTR_PORT_ID)
+            g_state.refs[attr.value.oid]--;
+    }
+
+    return removeObject(lag_member_id, MOCK_OBJECT_LAG_MEMBER);
+}
+
+/* API tables */
+
+static sai_switch_api_t             switch_api;
+static sai_port_api_t               port_api;
+static sai_vlan_api_t               vlan_api;
+static sai_virtual_router_api_t     virtual_router_api;
+static sai_router_interface_api_t   router_interface_api;
+static sai_hostif_api_t             hostif_api;
+static sai_neighbor_api_t           neighbor_api;
+static sai_next_hop_api_t           next_hop_api;
+static sai_next_hop_group_api_t     next_hop_group_api;
+static sai_route_api_t              route_api;
+static sai_route_bulk_api_t         route_bulk_api;
+static sai_lag_api_t                lag_api;
+
+static void initApiTables()
+{
+    switch_api.initialize_switch                    = mock_initialize_switch;
+    switch_api.shutdown_switch                      = mock_shutdown_switch;
+    switch_api.connect_switch                       = mock_connect_switch;
+    switch_api.disconnect_switch                    = mock_disconnect_switch;
+    switch_api.set_switch_attribute                 = mock_set_switch_attribute;
+    switch_api.get_switch_attribute                 = mock_get_switch_attribute;
+
+    port_api.set_port_attribute                     = mock_set_port_attribute;
+    port_api.get_port_attribute                     = mock_get_port_attribute;
+
+    vlan_api.create_vlan                            = mock_create_vlan;
+    vlan_api.remove_vlan                            = mock_remove_vlan;
+    vlan_api.set_vlan_attribute                     = mock_set_vlan_attribute;
+    vlan_api.get_vlan_attribute                     = mock_get_vlan_attribute;
+    vlan_api.create_vlan_member                     = mock_create_vlan_member;
+    vlan_api.remove_vlan_member                     = mock_remove_vlan_member;
+
+    virtual_router_api.create_virtual_router        = mock_create_virtual_router;
+    virtual_router_api.remove_virtual_router        = mock_remove_virtual_router;
+
+    router_interface_api.create_router_interface    = mock_create_router_interface;
+    router_interface_api.remove_router_interface    = mock_remove_router_interface;
+
+    hostif_api.create_hostif                        = mock_create_hostif;
+    hostif_api.remove_hostif                        = mock_remove_hostif;
+    hostif_api.set_trap_attribute                   = mock_set_trap_attribute;
+
+    neighbor_api.create_neighbor_entry              = mock_create_neighbor_entry;
+    neighbor_api.remove_neighbor_entry              = mock_remove_neighbor_entry;
+
+    next_hop_api.create_next_hop                    = mock_create_next_hop;
+    next_hop_api.remove_next_hop                    = mock_remove_next_hop;
+
+    next_hop_group_api.create_next_hop_group        = mock_create_next_hop_group;
+    next_hop_group_api.remove_next_hop_group        = mock_remove_next_hop_group;
+    next_hop_group_api.add_next_hop_to_group        = mock_add_next_hop_to_group;
+    next_hop_group_api.remove_next_hop_from_group   = mock_remove_next_hop_from_group;
+
+    route_api.create_route                          = mock_create_route;
+    route_api.remove_route                          = mock_remove_route;
+    route_api.set_route_attribute                   = mock_set_route_attribute;
+    route_api.get_route_attribute                   = mock_get_route_attribute;
+
+    route_bulk_api.create_routes                    = mock_create_routes;
+    route_bulk_api.remove_routes                    = mock_remove_routes;
+    route_bulk_api.set_routes_attribute             = mock_set_routes_attribute;
+
+    lag_api.create_lag                              = mock_create_lag;
+    lag_api.remove_lag                              = mock_remove_lag;
+    lag_api.create_lag_member                       = mock_create_lag_member;
+    lag_api.remove_lag_member                       = mock_remove_lag_member;
+}
+
+/* Configuration */
+
+static int getApiByName(const string &name)
+{
+    if (name == "all")
+        return SAI_API_UNSPECIFIED;
+
+    for (int api = 0; api < SAI_API_MAX; api++)
+    {
+        if (api_names[api] && name == api_names[api])
+            return api;
+    }
+    return -1;
+}
+
+/* Parse "<api>=<value>[,...]" and call set for every pair */
+template <typename T>
+static void parseApiList(const char *env, void (*set)(sai_api_t, T))
+{
+    const char *value = getenv(env);
+    if (!value)
+        return;
+
+    stringstream ss(value);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        size_t pos = item.find('=');
+        int api = pos == string::npos ? -1 : getApiByName(item.substr(0, pos));
+        if (api < 0)
+        {
+            SWSS_LOG_ERROR("saimock: invalid %s entry %s\n", env, item.c_str());
+            continue;
+        }
+
+        stringstream v(item.substr(pos + 1));
+        T t = T();
+        v >> t;
+        set((sai_api_t)api, t);
+    }
+}
+
+static void parseLimit(const char *env, saimock_limit_t limit)
+{
+    const char *value = getenv(env);
+    if (value)
+        saimock_set_limit(limit, (uint32_t)strtoul(value, NULL, 0));
+}
+
+void saimock_set_latency(sai_api_t api, uint32_t usec)
+{
+    for (int i = 0; i < SAI_API_MAX; i++)
+    {
+        if (api == SAI_API_UNSPECIFIED || api == i)
+            g_state.latency[i] = usec;
+    }
+}
+
+void saimock_set_failure_rate(sai_api_t api, double rate)
+{
+    for (int i = 0; i < SAI_API_MAX; i++)
+    {
+        if (api == SAI_API_UNSPECIFIED || api == i)
+            g_state.failure_rate[i] = rate;
+    }
+}
+
+void saimock_set_limit(saimock_limit_t limit, uint32_t count)
+{
+    g_state.limits[limit] = count;
+}
+
+uint32_t saimock_get_count(saimock_limit_t limit)
+{
+    switch (limit)
+    {
+    case SAIMOCK_LIMIT_ROUTES:
+        return (uint32_t)g_state.routes.size();
+    case SAIMOCK_LIMIT_NEIGHBORS:
+        return (uint32_t)g_state.neighbors.size();
+    case SAIMOCK_LIMIT_NEXT_HOPS:
+        return g_state.next_hop_count;
+    case SAIMOCK_LIMIT_NEXT_HOP_GROUPS:
+        return g_state.next_hop_group_count;
+    default:
+        return 0;
+    }
+}
+
+void saimock_set_port_count(uint32_t count)
+{
+    g_state.port_count = count;
+}
+
+sai_route_bulk_api_t *saimock_route_bulk_api(void)
+{
+    return &route_bulk_api;
+}
+
+/* SAI entry points */
+
+extern "C" {
+
+sai_status_t sai_api_initialize(uint64_t flags, const service_method_table_t *services)
+{
+    SWSS_LOG_ENTER();
+
+    initApiNames();
+    initApiTables();
+
+    if (!g_state.port_count)
+        g_state.port_count = DEFAULT_PORT_COUNT;
+
+    const char *ports = getenv("SAIMOCK_PORTS");
+    if (ports)
+        g_state.port_count = (uint32_t)strtoul(ports, NULL, 0);
+
+    const char *seed = getenv("SAIMOCK_SEED");
+    if (seed)
+        g_state.seed = (unsigned int)strtoul(seed, NULL, 0);
+
+    parseApiList<uint32_t>("SAIMOCK_LATENCY", saimock_set_latency);
+    parseApiList<double>("SAIMOCK_FAILURE", saimock_set_failure_rate);
+    parseLimit("SAIMOCK_MAX_ROUTES", SAIMOCK_LIMIT_ROUTES);
+    parseLimit("SAIMOCK_MAX_NEIGHBORS", SAIMOCK_LIMIT_NEIGHBORS);
+    parseLimit("SAIMOCK_MAX_NEXT_HOPS", SAIMOCK_LIMIT_NEXT_HOPS);
+    parseLimit("SAIMOCK_MAX_NEXT_HOP_GROUPS", SAIMOCK_LIMIT_NEXT_HOP_GROUPS);
+
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_api_query(sai_api_t sai_api_id, void **api_method_table)
+{
+    switch (sai_api_id)
+    {
+    case SAI_API_SWITCH:            *api_method_table = &switch_api; break;
+    case SAI_API_PORT:              *api_method_table = &port_api; break;
+    case SAI_API_VLAN:              *api_method_table = &vlan_api; break;
+    case SAI_API_VIRTUAL_ROUTER:    *api_method_table = &virtual_router_api; break;
+    case SAI_API_ROUTER_INTERFACE:  *api_method_table = &router_interface_api; break;
+    case SAI_API_HOST_INTERFACE:    *api_method_table = &hostif_api; break;
+    case SAI_API_NEIGHBOR:          *api_method_table = &neighbor_api; break;
+    case SAI_API_NEXT_HOP:          *api_method_table = &next_hop_api; break;
+    case SAI_API_NEXT_HOP_GROUP:    *api_method_table = &next_hop_group_api; break;
+    case SAI_API_ROUTE:             *api_method_table = &route_api; break;
+    case SAI_API_LAG:               *api_method_table = &lag_api; break;
+    default:
+        return SAI_STATUS_NOT_SUPPORTED;
+    }
+
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_api_uninitialize(void)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+sai_status_t sai_log_set(sai_api_t sai_api_id, sai_log_level_t log_level)
+{
+    return SAI_STATUS_SUCCESS;
+}
+
+}
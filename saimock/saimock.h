@@ -0,0 +1,53 @@
+#ifndef SWSS_SAIMOCK_H
+#define SWSS_SAIMOCK_H
+
+extern "C" {
+#include "sai.h"
+#include "saistatus.h"
+}
+
+#include "orchagent/saibulk.h"
+
+#include <stdint.h>
+
+/*
+ * In-memory implementation of the SAI APIs used by orchagent. Link against
+ * libsaimock instead of libsairedis to run the orchs without a switch.
+ *
+ * The behavior can be tuned through the functions below or, at
+ * sai_api_initialize time, through the environment:
+ *   SAIMOCK_PORTS=<n>                       front panel ports (default 32)
+ *   SAIMOCK_LATENCY=<api>=<us>[,...]        latency added to every call
+ *   SAIMOCK_FAILURE=<api>=<rate>[,...]      share of calls that fail
+ *   SAIMOCK_SEED=<n>                        seed of the failure injection
+ *   SAIMOCK_MAX_ROUTES=<n>                  and SAIMOCK_MAX_NEIGHBORS,
+ *   SAIMOCK_MAX_NEXT_HOPS, SAIMOCK_MAX_NEXT_HOP_GROUPS: table sizes
+ * where <api> is one of switch, port, vlan, virtual_router, route, next_hop,
+ * next_hop_group, router_interface, neighbor, host_interface, lag or all.
+ *
+ * Port i has the hardware lanes 4*i to 4*i+3. The mock is not thread safe.
+ */
+
+typedef enum _saimock_limit_t
+{
+    SAIMOCK_LIMIT_ROUTES,
+    SAIMOCK_LIMIT_NEIGHBORS,
+    SAIMOCK_LIMIT_NEXT_HOPS,
+    SAIMOCK_LIMIT_NEXT_HOP_GROUPS,
+    SAIMOCK_LIMIT_MAX
+} saimock_limit_t;
+
+/* Latency in microseconds added to every call of api, SAI_API_UNSPECIFIED for all */
+void saimock_set_latency(sai_api_t api, uint32_t usec);
+/* Share of the calls of api failing with SAI_STATUS_FAILURE, in [0, 1] */
+void saimock_set_failure_rate(sai_api_t api, double rate);
+/* Maximum number of objects of a table, 0 for no limit */
+void saimock_set_limit(saimock_limit_t limit, uint32_t count);
+/* Number of objects currently in a table */
+uint32_t saimock_get_count(saimock_limit_t limit);
+/* Number of ports created by the next initialize_switch */
+void saimock_set_port_count(uint32_t count);
+/* Native bulk route API, valid once sai_api_initialize was called */
+sai_route_bulk_api_t *saimock_route_bulk_api(void);
+
+#endif /* SWSS_SAIMOCK_H */
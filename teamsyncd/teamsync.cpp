@@ -16,7 +16,7 @@ using namespace swss;
 /* Taken from drivers/net/team/team.c */
 #define TEAM_DRV_NAME "team"
 
-TeamSync::TeamSync(DBConnector *db, Select *select) :
+TeamSync::TeamSync(DBConnector *db, EpollSelect *select) :
     m_select(select),
     m_lagTable(db, APP_LAG_TABLE_NAME)
 {
@@ -179,6 +179,11 @@ bool TeamSync::TeamPortSync::isMe(fd_set *fd)
     return FD_ISSET(team_get_event_fd(m_team), fd);
 }
 
+int TeamSync::TeamPortSync::getFd()
+{
+    return team_get_event_fd(m_team);
+}
+
 int TeamSync::TeamPortSync::readCache()
 {
     return NODATA;
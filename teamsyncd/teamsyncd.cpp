@@ -1,7 +1,7 @@
 #include <iostream>
 #include <team.h>
 #include "logger.h"
-#include "select.h"
+#include "common/epollselect.h"
 #include "netdispatcher.h"
 #include "netlink.h"
 #include "teamsync.h"
@@ -12,7 +12,7 @@ using namespace swss;
 int main(int argc, char **argv)
 {
     DBConnector db(APPL_DB, "localhost", 6379, 0);
-    Select s;
+    EpollSelect s;
     TeamSync sync(&db, &s);
 
     NetDispatcher::getInstance().registerMessageHandler(RTM_NEWLINK, &sync);
@@ -31,9 +31,8 @@ int main(int argc, char **argv)
             s.addSelectable(&netlink);
             while (true)
             {
-                Selectable *temps;
-                int tempfd;
-                s.select(&temps, &tempfd);
+                vector<Selectable *> ready;
+                s.select(ready);
             }
         }
         catch (...)